@@ -0,0 +1,314 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024-Present Kevin Traini
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <csignal>
+#include <cstdlib>
+#include <enquirer.h>
+#include <fcntl.h>
+#include <new>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+// Allocations
+
+static atomic<size_t> allocations{0};
+
+auto operator new(size_t size) -> void * {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *ptr = malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+auto operator delete(void *ptr) noexcept -> void {
+    free(ptr);
+}
+
+auto operator delete(void *ptr, size_t) noexcept -> void {
+    free(ptr);
+}
+
+// _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+// Terminal
+
+namespace keys {
+    const string up    = "\033[A";
+    const string down  = "\033[B";
+    const string right = "\033[C";
+    const string left  = "\033[D";
+    const string tab   = "\t";
+    const string del   = "\x7F";
+    const string enter = "\n";
+}// namespace keys
+
+// Input typed one key at a time: a key is never pending while the previous one is handled, so every key is drawn
+class typist : public streambuf {
+public:
+    explicit typist(vector<string> keys) : keys(std::move(keys)) {}
+
+    auto size() const -> size_t {
+        return keys.size();
+    }
+
+    auto rewind() -> void {
+        next = 0;
+        setg(nullptr, nullptr, nullptr);
+    }
+
+protected:
+    auto showmanyc() -> streamsize override {
+        return (next < keys.size()) ? 0 : -1;
+    }
+
+    auto underflow() -> int_type override {
+        if (next >= keys.size()) return traits_type::eof();
+
+        string &key = keys[next++];
+        setg(&key[0], &key[0], &key[0] + key.size());
+        return traits_type::to_int_type(key[0]);
+    }
+
+private:
+    vector<string> keys;
+    size_t next = 0;
+};
+
+// Output counting the bytes and the frames (one flush per frame) instead of printing them
+class screen : public streambuf {
+public:
+    size_t bytes  = 0;
+    size_t frames = 0;
+
+protected:
+    auto overflow(int_type c) -> int_type override {
+        bytes++;
+        return c;
+    }
+
+    auto xsputn(const char *, streamsize count) -> streamsize override {
+        bytes += count;
+        return count;
+    }
+
+    auto sync() -> int override {
+        frames++;
+        return 0;
+    }
+};
+
+// Size of the terminal the prompts are laid out in
+static constexpr unsigned short terminal_rows    = 24;
+static constexpr unsigned short terminal_columns = 80;
+
+// Stdout on a pseudo terminal of a fixed size while it exists, the prompts read their size from it as from a real
+// terminal. Their output still goes to std::cout
+class sized_terminal {
+public:
+    sized_terminal(unsigned short rows, unsigned short columns) {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return;
+        slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (slave < 0) return;
+
+        struct winsize size {};
+        size.ws_row = rows;
+        size.ws_col = columns;
+        ioctl(slave, TIOCSWINSZ, &size);
+        fflush(stdout);
+        saved = dup(STDOUT_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        resized();
+    }
+
+    sized_terminal(const sized_terminal &)                     = delete;
+    auto operator=(const sized_terminal &) -> sized_terminal & = delete;
+
+    ~sized_terminal() {
+        if (saved >= 0) {
+            dup2(saved, STDOUT_FILENO);
+            close(saved);
+            resized();
+        }
+        if (slave >= 0) close(slave);
+        if (master >= 0) close(master);
+    }
+
+private:
+    // Refresh the size cached by enquirer, and read the resize key it reports so no prompt gets it
+    static auto resized() -> void {
+        raise(SIGWINCH);
+        stringbuf empty;
+        streambuf *old = cin.rdbuf(&empty);
+        enquirer::utils::key_event event;
+        while (enquirer::utils::read_key(event)) {}
+        cin.rdbuf(old);
+    }
+
+    int master = -1;
+    int slave  = -1;
+    int saved  = -1;
+};
+
+// Replay `input` through `prompt` in every iteration and report the cost of a keystroke
+template<typename Prompt>
+auto replay(benchmark::State &state, vector<string> input, Prompt prompt) -> void {
+    enquirer::set_prompt_mode(enquirer::prompt_mode::interactive);
+    enquirer::set_flush_policy(enquirer::flush_policy::stream);
+
+    sized_terminal window(terminal_rows, terminal_columns);
+    typist keyboard(std::move(input));
+    screen terminal;
+    streambuf *cin_buffer  = cin.rdbuf(&keyboard);
+    streambuf *cout_buffer = cout.rdbuf(&terminal);
+
+    size_t allocated = 0;
+    for (auto _: state) {
+        keyboard.rewind();
+        size_t before = allocations.load(memory_order_relaxed);
+        benchmark::DoNotOptimize(prompt());
+        allocated += allocations.load(memory_order_relaxed) - before;
+    }
+
+    cout.rdbuf(cout_buffer);
+    cin.rdbuf(cin_buffer);
+
+    const auto keystrokes             = (double) (keyboard.size() * state.iterations());
+    state.counters["time/keystroke"]  = benchmark::Counter(keystrokes, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["bytes/frame"]     = (double) terminal.bytes / (double) max<size_t>(terminal.frames, 1);
+    state.counters["allocs/keystroke"] = (double) allocated / keystrokes;
+}
+
+auto repeat(const string &key, size_t count) -> vector<string> {
+    return vector<string>(count, key);
+}
+
+auto type(vector<string> &input, const string &text) -> void {
+    for (char c: text) {
+        input.emplace_back(1, c);
+    }
+}
+
+// Words of a pseudo-random dictionary, the same for each run
+auto dictionary(size_t count) -> vector<string> {
+    vector<string> words;
+    words.reserve(count);
+    uint32_t seed = 42;
+    for (size_t i = 0; i < count; i++) {
+        string word;
+        size_t length = 4 + i % 9;
+        for (size_t j = 0; j < length; j++) {
+            seed = seed * 1664525 + 1013904223;
+            word += (char) ('a' + (seed >> 24) % 26);
+        }
+        words.push_back(word);
+    }
+    return words;
+}
+
+// _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+// Prompts
+
+static void select(benchmark::State &state) {
+    vector<string> choices;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        choices.push_back("choice " + to_string(i));
+    }
+
+    auto input = repeat(keys::down, 100);
+    input.push_back(keys::enter);
+    replay(state, input, [&choices] { return enquirer::select("Choose", choices); });
+
+    // Only the rows in the terminal are drawn, whatever the size of the list
+    if (state.counters["bytes/frame"] > terminal_rows * 32.0) {
+        state.SkipWithError("frames larger than the terminal");
+    }
+}
+BENCHMARK(select)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+static void autocomplete(benchmark::State &state) {
+    const auto mode    = state.range(1) == 0 ? enquirer::match_mode::prefix : enquirer::match_mode::fuzzy;
+    const auto choices = dictionary(state.range(0));
+
+    vector<string> input;
+    type(input, "abcde");
+    input.insert(input.end(), 3, keys::del);
+    type(input, "xyz");
+    input.push_back(keys::down);
+    input.push_back(keys::tab);
+    input.push_back(keys::enter);
+    replay(state, input, [&choices, mode] { return enquirer::autocomplete("Word", choices, 10, mode); });
+}
+BENCHMARK(autocomplete)->ArgsProduct({{1000, 100000}, {0, 1}})->ArgNames({"words", "fuzzy"})->Unit(benchmark::kMicrosecond);
+
+static void form(benchmark::State &state) {
+    vector<string> inputs;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        inputs.push_back("field " + to_string(i));
+    }
+
+    vector<string> input;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        type(input, "value");
+        input.push_back(keys::down);
+    }
+    input.push_back(keys::enter);
+    replay(state, input, [&inputs] { return enquirer::form("Fill", inputs); });
+}
+BENCHMARK(form)->Arg(10)->Arg(100)->Unit(benchmark::kMicrosecond);
+
+static void slider(benchmark::State &state) {
+    auto input = repeat(keys::right, state.range(0));
+    input.insert(input.end(), state.range(0), keys::left);
+    input.push_back(keys::enter);
+    replay(state, input, [&state] { return enquirer::slider<int>("Volume", 0, (int) state.range(0), 1, 0); });
+}
+BENCHMARK(slider)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+static void input(benchmark::State &state) {
+    vector<string> input;
+    type(input, string(state.range(0), 'x'));
+    input.push_back(keys::enter);
+    replay(state, input, [] { return enquirer::input("Type"); });
+}
+BENCHMARK(input)->Arg(100)->Unit(benchmark::kMicrosecond);
+
+static void list(benchmark::State &state) {
+    string hosts;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        hosts += "host-" + to_string(i) + ".example.com, ";
+    }
+
+    vector<string> input = {"\033[200~" + hosts + "\033[201~"};
+    type(input, "last.example.com");
+    input.push_back(keys::enter);
+    replay(state, input, [] { return enquirer::list("Hosts"); });
+}
+BENCHMARK(list)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
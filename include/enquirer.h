@@ -26,12 +26,25 @@
 
 #define ENQUIRER_VERSION "1.0.2"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <sys/ioctl.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
@@ -40,28 +53,297 @@ namespace enquirer {
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Utilities
 
+    // Text attributes and foreground color written with a single SGR sequence, e.g. `ESC[1;36m` for bold cyan.
+    // Styles are merged with `|`, the sequence is built at compile time
+    class style {
+    public:
+        constexpr style() = default;
+
+        // `attributes` are bits of reset, bold, underline, blink and inverse, `foreground` is the SGR code of the color
+        constexpr style(unsigned char attributes, unsigned char foreground) : attributes(attributes), foreground(foreground) {
+            if (attributes == 0 && foreground == 0) return;// Nothing to write
+
+            bool first       = true;
+            sequence[size++] = '\033';
+            sequence[size++] = '[';
+            for (unsigned int i = 0; i < attribute_codes.size(); i++) {
+                if (attributes & (1 << i)) {
+                    append(attribute_codes[i], first);
+                }
+            }
+            if (foreground != 0) {
+                append(foreground, first);
+            }
+            sequence[size++] = 'm';
+        }
+
+        // This style with the attributes of `other`, and its color if it has one
+        constexpr auto operator|(style other) const -> style {
+            return {(unsigned char) (attributes | other.attributes), other.foreground != 0 ? other.foreground : foreground};
+        }
+
+        constexpr operator std::string_view() const {
+            return {sequence.data(), size};
+        }
+
+        // Kept for the code which stored the colors in strings
+        operator std::string() const {
+            return {sequence.data(), size};
+        }
+
+    private:
+        static constexpr std::array<unsigned char, 5> attribute_codes = {0, 1, 4, 5, 7};
+
+        constexpr auto append(unsigned int code, bool &first) -> void {
+            if (!first) sequence[size++] = ';';
+            first = false;
+            if (code >= 10) sequence[size++] = (char) ('0' + code / 10);
+            sequence[size++] = (char) ('0' + code % 10);
+        }
+
+        unsigned char attributes = 0;
+        unsigned char foreground = 0;
+        std::array<char, 20> sequence{};
+        unsigned char size = 0;
+    };
+
+    // Kept for the code which concatenated the colors when they were strings
+    constexpr auto operator+(style left, style right) -> style {
+        return left | right;
+    }
+
+    inline auto operator+(style left, const std::string &right) -> std::string {
+        return std::string(std::string_view(left)) + right;
+    }
+
+    inline auto operator+(style left, const char *right) -> std::string {
+        return std::string(std::string_view(left)) + right;
+    }
+
+    inline auto operator+(const std::string &left, style right) -> std::string {
+        return left + std::string(std::string_view(right));
+    }
+
+    inline auto operator<<(std::ostream &os, style value) -> std::ostream & {
+        return os << std::string_view(value);
+    }
+
     namespace color {
-        const std::string black   = "\033[30m";
-        const std::string red     = "\033[31m";
-        const std::string green   = "\033[32m";
-        const std::string yellow  = "\033[33m";
-        const std::string blue    = "\033[34m";
-        const std::string magenta = "\033[35m";
-        const std::string cyan    = "\033[36m";
-        const std::string white   = "\033[37m";
-        const std::string grey    = "\033[90m";
-
-        const std::string reset     = "\033[0m";
-        const std::string bold      = "\033[1m";
-        const std::string underline = "\033[4m";
-        const std::string blink     = "\033[5m";
-        const std::string inverse   = "\033[7m";
+        inline constexpr style black   = {0, 30};
+        inline constexpr style red     = {0, 31};
+        inline constexpr style green   = {0, 32};
+        inline constexpr style yellow  = {0, 33};
+        inline constexpr style blue    = {0, 34};
+        inline constexpr style magenta = {0, 35};
+        inline constexpr style cyan    = {0, 36};
+        inline constexpr style white   = {0, 37};
+        inline constexpr style grey    = {0, 90};
+
+        inline constexpr style reset     = {1 << 0, 0};
+        inline constexpr style bold      = {1 << 1, 0};
+        inline constexpr style underline = {1 << 2, 0};
+        inline constexpr style blink     = {1 << 3, 0};
+        inline constexpr style inverse   = {1 << 4, 0};
     }// namespace color
 
+    // Styles and symbols of the prompts, see set_theme
+    struct theme {
+        style question  = color::cyan | color::bold; // Symbol of a question waiting for its answer
+        style answered  = color::green | color::bold;// Symbol of an answered question
+        style separator = color::grey | color::bold; // Between the question and the answer
+        style answer    = color::cyan;
+        style highlight = color::cyan | color::underline;// Choice under the cursor
+        style pointer   = color::cyan | color::bold;     // Arrow in front of the choice under the cursor of select
+        style active    = color::cyan;                   // Label of the field being typed in form and auth
+        style hint      = color::grey;                   // Rest of a default value or a completion, previews
+        style checked   = color::green | color::bold;
+        style unchecked = color::grey;
+        style success   = color::green;// Positive answer of confirm and toggle, right answer of quiz
+        style failure   = color::red;
+        style slider    = color::cyan | color::bold;// Ends and marker of the bar
+        style bar       = color::grey;
+
+        std::string_view question_symbol  = "? ";
+        std::string_view answered_symbol  = "✔ ";
+        std::string_view input_symbol     = "› ";
+        std::string_view answer_symbol    = "· ";
+        std::string_view pointer_symbol   = "> ";
+        std::string_view check_symbol     = "✔ ";
+        std::string_view empty_symbol     = "⊙ ";// Field of form and auth not filled yet
+        std::string_view filled_symbol    = "⦿ ";
+    };
+
+    // Theme of the following prompts, the symbols must outlive their use
+    auto set_theme(const theme &value) -> void;
+
+    enum class flush_policy {
+        frame,// Each frame is sent to the terminal with a single write(2)
+        stream// Each frame is written and flushed to std::cout, e.g. when it is redirected
+    };
+
+    auto set_flush_policy(flush_policy policy) -> void;
+
+    enum class prompt_mode {
+        automatic,  // Headless when stdin or stdout is not a terminal
+        interactive,// Prompts are drawn and answered with the keyboard
+        headless    // Answers are read from std::cin, one line per question, and nothing is drawn
+    };
+
+    auto set_prompt_mode(prompt_mode mode) -> void;
+
+    // Measures of a prompt call, given to the metrics observer when the prompt returns
+    struct prompt_metrics {
+        std::string_view prompt;// Name of the prompt, e.g. "select"
+        std::string question;
+        std::size_t keystrokes = 0;// Keys decoded, a paste counts as one
+        std::size_t frames     = 0;// Frames sent to the terminal
+        std::size_t bytes      = 0;// Bytes of these frames
+        std::size_t syscalls   = 0;// write(2) calls, none with flush_policy::stream
+        std::chrono::nanoseconds waiting{};  // Waiting for the keys
+        std::chrono::nanoseconds matching{}; // Finding the completions of autocomplete
+        std::chrono::nanoseconds rendering{};// Everything else: handling the keys and drawing the frames
+        std::chrono::nanoseconds wall{};     // From the call until the answer
+    };
+
+    // Call `observer` each time a prompt returns, an empty function disables the metrics
+    auto set_metrics_observer(std::function<void(const prompt_metrics &)> observer) -> void;
+
+    // How list splits its answer into items, the spaces around each item are removed
+    struct list_format {
+        std::string delimiters = ",";// Each of these characters ends an item
+        char quote             = '"';// Delimiters and spaces between quotes are part of the item, a doubled quote
+                                     // stands for itself. 0 disables the quoting
+    };
+
+    // Thrown in headless mode when an answer is missing or invalid
+    class answer_error : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
     namespace utils {
-        auto move_up(unsigned int n = 1) -> std::string;
+        // Control sequence `ESC [ n command`, formatted on demand without allocation
+        struct control_sequence {
+            static constexpr size_t max_size = 14;
+
+            unsigned int n;
+            char command;
+
+            // Write the sequence at `dest` which must hold at least max_size chars, returns the end of the sequence
+            auto write(char *dest) const -> char * {
+                *dest++ = '\033';
+                *dest++ = '[';
+                dest    = std::to_chars(dest, dest + max_size - 3, n).ptr;
+                *dest++ = command;
+                return dest;
+            }
+
+            operator std::string() const {
+                char seq[max_size];
+                return {seq, write(seq)};
+            }
+        };
+
+        // Control sequence whose argument is known at compile time, fully built at compile time
+        template<unsigned int N, char Command>
+        class constant_sequence {
+            static constexpr auto digits() -> size_t {
+                size_t count = 1;
+                for (unsigned int n = N; n >= 10; n /= 10) count++;
+                return count;
+            }
+
+            static constexpr auto make() -> std::array<char, digits() + 3> {
+                std::array<char, digits() + 3> seq{};
+                seq[0]         = '\033';
+                seq[1]         = '[';
+                unsigned int n = N;
+                for (size_t i = digits() + 1; i >= 2; i--) {
+                    seq[i] = (char) ('0' + n % 10);
+                    n /= 10;
+                }
+                seq[digits() + 2] = Command;
+                return seq;
+            }
+
+            static constexpr std::array<char, digits() + 3> chars = make();
+
+        public:
+            static constexpr std::string_view value{chars.data(), chars.size()};
+        };
+
+        // Output of the prompts, built in a reusable buffer and sent to the terminal once per frame
+        class frame_buffer {
+        public:
+            auto operator<<(std::string_view str) -> frame_buffer &;
+
+            auto operator<<(char c) -> frame_buffer &;
+
+            auto operator<<(control_sequence seq) -> frame_buffer &;
+
+            template<typename N,
+                     typename = typename std::enable_if<std::is_arithmetic<N>::value>::type>
+            auto operator<<(N value) -> frame_buffer & {
+                char str[64];
+                if constexpr (std::is_floating_point<N>::value) {// Same format as std::ostream
+                    int length = std::snprintf(str, sizeof(str), "%g", (double) value);
+                    buffer.append(str, length);
+                } else {
+                    auto result = std::to_chars(str, str + sizeof(str), value);
+                    buffer.append(str, result.ptr);
+                }
+                return *this;
+            }
+
+            // Append `count` times `c`
+            auto fill(size_t count, char c) -> frame_buffer &;
+
+            // Send the current frame according to the flush policy
+            auto flush() -> void;
+
+        private:
+            std::string buffer;
+        };
 
-        auto move_left(unsigned int n = 1) -> std::string;
+        auto out() -> frame_buffer &;
+
+        auto operator<<(std::ostream &os, control_sequence seq) -> std::ostream &;
+
+        constexpr auto move_up(unsigned int n = 1) -> control_sequence {
+            return {n, 'A'};
+        }
+
+        constexpr auto move_down(unsigned int n = 1) -> control_sequence {
+            return {n, 'B'};
+        }
+
+        constexpr auto move_right(unsigned int n = 1) -> control_sequence {
+            return {n, 'C'};
+        }
+
+        constexpr auto move_left(unsigned int n = 1) -> control_sequence {
+            return {n, 'D'};
+        }
+
+        template<unsigned int N>
+        constexpr auto move_up() -> std::string_view {
+            return constant_sequence<N, 'A'>::value;
+        }
+
+        template<unsigned int N>
+        constexpr auto move_down() -> std::string_view {
+            return constant_sequence<N, 'B'>::value;
+        }
+
+        template<unsigned int N>
+        constexpr auto move_right() -> std::string_view {
+            return constant_sequence<N, 'C'>::value;
+        }
+
+        template<unsigned int N>
+        constexpr auto move_left() -> std::string_view {
+            return constant_sequence<N, 'D'>::value;
+        }
 
         typedef enum {
             EOL  = 0,
@@ -69,23 +351,521 @@ namespace enquirer {
             LINE = 2
         } clear_mode;
 
-        auto clear_line(clear_mode mode) -> std::string;
+        constexpr auto clear_line(clear_mode mode) -> control_sequence {
+            return {(unsigned int) mode, 'K'};
+        }
+
+        template<clear_mode Mode>
+        constexpr auto clear_line() -> std::string_view {
+            return constant_sequence<Mode, 'K'>::value;
+        }
+
+        constexpr auto save_cursor() -> std::string_view {
+            return "\0337";
+        }
+
+        constexpr auto restore_cursor() -> std::string_view {
+            return "\0338";
+        }
+
+        constexpr auto hide_cursor() -> std::string_view {
+            return "\033[?25l";
+        }
+
+        constexpr auto show_cursor() -> std::string_view {
+            return "\033[?25h";
+        }
+
+        // While enabled, the terminal surrounds pasted text with `ESC [ 200 ~` and `ESC [ 201 ~`
+        constexpr auto enable_paste() -> std::string_view {
+            return "\033[?2004h";
+        }
+
+        constexpr auto disable_paste() -> std::string_view {
+            return "\033[?2004l";
+        }
+
+        // Keys decoded from the input
+        enum class key {
+            character,// Printable character, or one byte of a multibyte UTF-8 character
+            control,  // Other control character, e.g. Ctrl+A
+            enter,
+            tab,
+            backspace,
+            escape,
+            up,
+            down,
+            right,
+            left,
+            home,
+            end,
+            page_up,
+            page_down,
+            insert,
+            del,
+            paste,  // Text pasted while bracketed paste is enabled
+            resize, // The terminal was resized, see terminal_size
+            unknown// Well-formed but unsupported sequence, e.g. a function key
+        };
+
+        struct key_event {
+            static constexpr unsigned char shift = 1;
+            static constexpr unsigned char alt   = 2;
+            static constexpr unsigned char ctrl  = 4;
+
+            key code                = key::unknown;
+            char character          = 0;// Byte read for key::character and key::control
+            unsigned char modifiers = 0;
+            std::string text;// Pasted text for key::paste
+        };
+
+        // Read and decode the next key, returns false at the end of the input
+        auto read_key(key_event &event) -> bool;
+
+        // Whether a key is waiting to be read
+        auto input_pending() -> bool;
+
+        // Size of the terminal, only queried again after a SIGWINCH
+        auto terminal_size() -> winsize;
+
+        // Columns taken by `text` on the terminal: 2 for East Asian wide characters, none for combining marks
+        // and control characters, 1 for the others. Invalid UTF-8 bytes take 1 column each
+        auto display_width(std::string_view text) -> size_t;
+
+        // Cells of a slider bar of `steps` steps which fit in the terminal
+        inline auto slider_width(unsigned int steps) -> unsigned int {
+            const unsigned int columns = terminal_size().ws_col;
+            if (columns <= 7) {// Unknown size, e.g. not a terminal
+                return steps;
+            }
+
+            return std::min(steps, columns - 7);// 7 is for < > # and 2 spaces each side
+        }
+
+        // Cell of a slider bar (cells 0 to `width`, each `swidth` wide) holding `value`, -1 if none does
+        template<typename N>
+        auto slider_cell(N value, N min_value, N swidth, unsigned int width) -> int {
+            if (swidth <= 0) return -1;
+
+            const auto guess = (long long) ((value - min_value) / swidth);
+            for (long long i = std::max(guess - 1, 0LL); i <= guess + 1 && i <= (long long) width; i++) {// Rounding
+                N l = min_value + ((N) i * swidth);
+                N r = min_value + ((N) (i + 1) * swidth);
+                if (value >= l && value < r) {
+                    return (int) i;
+                }
+            }
+            return -1;
+        }
+
+        // Value line of a slider, centered over a bar of `width` cells
+        template<typename N>
+        auto slider_label(N value, unsigned int width) -> void {
+            out() << "   ";
+            out().fill((width / 2) - (std::to_string(value).length() / 2), ' ')
+                    << color::bold << value << color::reset;
+        }
+
+        // Bar of a slider with the marker in the cell `marker`, a color sequence per run of cells
+        auto slider_bar(unsigned int width, int marker) -> void;
+
+        // Move the marker of a slider bar from the cell `from` to the cell `to`, the cursor is at the beginning of the bar
+        auto move_slider_marker(int from, int to) -> void;
+
+        // Collect the metrics of the prompt call during which it exists, only when an observer is set
+        class prompt_scope {
+        public:
+            prompt_scope(std::string_view prompt, const std::string &question);
+
+            prompt_scope(const prompt_scope &)                     = delete;
+            auto operator=(const prompt_scope &) -> prompt_scope & = delete;
+
+            ~prompt_scope();
+
+        private:
+            bool enabled;
+            prompt_metrics metrics;
+            prompt_metrics *outer;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        // Whether the prompts read their answers from an answer stream instead of the keyboard
+        auto headless() -> bool;
+
+        // Next line of the answer stream, without the `key=` prefix when the line starts with it.
+        // Throws answer_error at the end of the stream
+        auto read_answer(const std::string &key) -> std::string;
+
+        // Remove the sign in front of `text`, returns false if N cannot take it
+        template<typename N>
+        auto strip_sign(std::string_view &text, bool &negative) -> bool {
+            negative = !text.empty() && text[0] == '-';
+            if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+                text.remove_prefix(1);
+                return !negative || std::is_signed<N>::value;
+            }
+            return true;
+        }
+
+        // Whether `text` is written with a 0x prefix
+        inline auto hex_prefix(std::string_view text) -> bool {
+            return text.size() >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+        }
+
+        // std::from_chars for the floating point types `N`, in hexadecimal without the 0x prefix or in the general format.
+        // The standard libraries which lack it (libc++ before LLVM 20) get a strtod fallback on a copy of the text
+        template<typename N>
+        auto float_from_chars(const char *first, const char *last, N &value, bool hex) -> std::from_chars_result {
+#if defined(__cpp_lib_to_chars)
+            return std::from_chars(first, last, value, hex ? std::chars_format::hex : std::chars_format::general);
+#else
+            const size_t prefix    = hex ? 2 : 0;// strtod only reads hexadecimal after a 0x prefix
+            const std::string copy = std::string(hex ? "0x" : "") + std::string(first, last);
+            char *end;
+            N parsed;
+            errno = 0;
+            if constexpr (std::is_same<N, float>::value) {
+                parsed = std::strtof(copy.c_str(), &end);
+            } else if constexpr (std::is_same<N, double>::value) {
+                parsed = std::strtod(copy.c_str(), &end);
+            } else {
+                parsed = std::strtold(copy.c_str(), &end);
+            }
+
+            const auto consumed = (size_t) (end - copy.c_str());
+            if (first == last || consumed <= prefix) return {first, std::errc::invalid_argument};
+            if (errno == ERANGE) return {first + consumed - prefix, std::errc::result_out_of_range};
+            value = parsed;
+            return {first + consumed - prefix, std::errc()};
+#endif
+        }
+
+        // Convert `text` to the number `value` with std::from_chars: an optional sign, then decimal or 0x prefixed
+        // hexadecimal digits, with a point and an exponent (e, or p in hexadecimal) for the floating point types.
+        // Returns false if `text` is not such a number or is out of the range of N
+        template<typename N>
+        auto to_number(std::string_view text, N &value) -> bool {
+            if constexpr (std::is_same<N, bool>::value) {
+                unsigned int digit;
+                if (!to_number(text, digit) || digit > 1) return false;
+                value = digit == 1;
+                return true;
+            } else {
+                bool negative;
+                if (!strip_sign<N>(text, negative)) return false;
+
+                const bool hex = hex_prefix(text);
+                if (hex) text.remove_prefix(2);
+                if (text.empty() || !(isxdigit((unsigned char) text[0]) || text[0] == '.')) return false;// No second sign, no inf or nan
+
+                const char *const end = text.data() + text.size();
+                if constexpr (std::is_integral<N>::value) {// The magnitude is parsed unsigned, the range depends on the sign
+                    using U = typename std::make_unsigned<N>::type;
+                    U magnitude;
+                    auto result = std::from_chars(text.data(), end, magnitude, hex ? 16 : 10);
+                    if (result.ec != std::errc() || result.ptr != end) return false;
+
+                    const U limit = (U) std::numeric_limits<N>::max() + (negative ? 1 : 0);
+                    if (magnitude > limit) return false;
+                    value = negative ? (N) (U(0) - magnitude) : (N) magnitude;
+                } else {
+                    auto result = float_from_chars(text.data(), end, value, hex);
+                    if (result.ec != std::errc() || result.ptr != end) return false;
+                    if (negative) value = -value;
+                }
+                return true;
+            }
+        }
+
+        // Whether `text` is the beginning of a number accepted by to_number<N>, with a value in the range of N.
+        // Checked on each key of number<N>, so that only the characters valid for N are typed
+        template<typename N>
+        auto number_prefix(std::string_view text) -> bool {
+            const std::string_view typed = text;
+            bool negative;
+            if (!strip_sign<N>(text, negative)) return false;
+            if (text.empty() || text == "0") return true;
+
+            const bool hex                = hex_prefix(text);
+            const std::string_view digits = hex ? text.substr(2) : text;
+            auto is_digit                 = [hex](char c) {
+                return hex ? isxdigit((unsigned char) c) : isdigit((unsigned char) c);
+            };
+
+            if constexpr (std::is_integral<N>::value) {
+                if (digits.empty()) return true;
+                if (!std::all_of(digits.begin(), digits.end(), is_digit)) return false;
+
+                N value;
+                return to_number(typed, value);
+            } else {
+                // Digits with at most one point, then an exponent with its own sign
+                size_t i      = 0;
+                bool point    = false;
+                bool mantissa = false;
+                for (; i < digits.size(); i++) {
+                    if (is_digit(digits[i])) {
+                        mantissa = true;
+                    } else if (digits[i] == '.' && !point) {
+                        point = true;
+                    } else {
+                        break;
+                    }
+                }
+                if (i < digits.size()) {
+                    if (!mantissa || tolower((unsigned char) digits[i]) != (hex ? 'p' : 'e')) return false;
+                    if (++i < digits.size() && (digits[i] == '+' || digits[i] == '-')) i++;
+                    if (!std::all_of(digits.begin() + i, digits.end(), [](char c) { return isdigit((unsigned char) c); })) return false;
+                }
+
+                // Only an overflow rejects an incomplete number, e.g. "1e"
+                N value;
+                auto result = float_from_chars(digits.data(), digits.data() + digits.size(), value, hex);
+                return result.ec != std::errc::result_out_of_range;
+            }
+        }
+
+        // Parse `answer` as a number, throws answer_error if it is not one
+        template<typename N>
+        auto parse_number(const std::string &question, const std::string &answer) -> N {
+            std::string_view text = answer;
+            const size_t first    = text.find_first_not_of(" \t");
+            text                  = (first == std::string_view::npos) ? "" : text.substr(first, text.find_last_not_of(" \t") - first + 1);
+
+            N number;
+            if (!to_number(text, number)) {
+                throw answer_error(question + ": '" + answer + "' is not a number");
+            }
+
+            return number;
+        }
+
+        // Answer of the single line prompts, kept in a gap buffer so the edits at the cursor are O(1) amortized.
+        // Each edit redraws the line from the edit point, the terminal cursor follows the cursor of the line.
+        // An answer wider than the terminal scrolls horizontally, the row of the question never wraps
+        class line_editor {
+        public:
+            enum class echo {
+                text,// Print the answer
+                mask,// Print a mask character per character of the answer
+                none // Print nothing
+            };
+
+            // `origin` is the column of the terminal where the answer begins
+            explicit line_editor(size_t origin, echo mode = echo::text, char mask = '*');
+
+            // Apply an editing key: characters, paste, arrows, Home/End, Backspace/Delete and the Emacs keys
+            // (Ctrl+A/E/B/F/D/K/U/W/Y, Alt+B/F/D/Backspace), and a resize. Returns false if the key is not an editing key
+            auto edit(const key_event &key) -> bool;
+
+            // Insert `text` at the cursor, without its control characters
+            auto insert(std::string_view text) -> void;
+
+            // Grey text shown after the end of the answer, e.g. the rest of a default value
+            auto set_hint(std::string hint) -> void;
+
+            auto text() const -> std::string;
+
+            // Append the text from the byte offset `from` to `dest`
+            auto append_to(std::string &dest, size_t from) const -> void;
+
+            // Size in bytes
+            auto size() const -> size_t;
+
+            auto empty() const -> bool;
+
+            // Byte offset of the cursor
+            auto cursor() const -> size_t;
+
+        private:
+            auto at(size_t i) const -> char;
+
+            auto code_point(size_t i) const -> char32_t;
+
+            auto move_gap(size_t position) -> void;
+
+            auto move_to(size_t position) -> void;
+
+            // Remove the bytes between `from` and `to`, cursor is at `from` afterwards
+            auto erase(size_t from, size_t to, bool kill) -> void;
+
+            // Offset of the previous / next character (with its combining marks), word start or word end
+            auto previous_char(size_t i) const -> size_t;
+            auto next_char(size_t i) const -> size_t;
+            auto previous_word(size_t i) const -> size_t;
+            auto next_word(size_t i) const -> size_t;
+
+            // Columns of the bytes between `from` and `to`
+            auto columns(size_t from, size_t to) const -> size_t;
+
+            // Whether the byte offset `position` is in the visible part of the answer
+            auto visible(size_t position) const -> bool;
+
+            // Scroll the answer so that the cursor is visible, in the middle of the row if the beginning is hidden
+            auto scroll_to_cursor() -> void;
+
+            // Rewrite the visible part of the answer from the answer column
+            auto redraw() -> void;
+
+            // Rewrite the line from the cursor to the end of the hint, the terminal cursor is back at the cursor afterwards
+            auto redraw_tail() -> void;
+
+            echo mode;
+            char mask;
+            size_t origin;
+            size_t width;     // Columns of the visible part of the answer, 0 if it is not limited
+            size_t scroll = 0;// Byte offset of the first visible character
+            std::string buffer;// Text before the cursor, gap, text after the cursor
+            size_t gap_begin = 0;
+            size_t gap_end   = 0;
+            std::string killed;// Last killed text, for Ctrl+Y
+            std::string hint;
+        };
+
+        // Items of `text`, split as described by `format`. Only the vector and the items are allocated
+        auto tokenize(std::string_view text, const list_format &format) -> std::vector<std::string>;
+
+        // Items of the answer of list while it is typed, only the items from the edit point are tokenized again
+        class list_tokenizer {
+        public:
+            explicit list_tokenizer(list_format format);
+
+            // Tokenize `answer` again from the item holding the byte offset `from`, the text before it did not change
+            auto update(const line_editor &answer, size_t from) -> void;
+
+            auto size() const -> size_t;
+
+            // Item `i`, without its surrounding spaces and its quotes
+            auto item(size_t i) const -> std::string;
 
-        auto hide_cursor() -> std::string;
+            auto items() const -> std::vector<std::string>;
 
-        auto show_cursor() -> std::string;
+        private:
+            struct span {
+                size_t begin;
+                size_t end;
+                bool quoted;
+            };
 
-        auto print_question(const std::string &question,
-                            const std::string &symbol = color::cyan + color::bold + "? ",
-                            const std::string &input  = color::grey + color::bold + "› ") -> void;
+            list_format format;
+            std::array<bool, 256> delimiters{};
+            std::string text;// Copy of the answer
+            std::vector<span> spans;
+        };
 
-        auto print_answer(const std::string &question) -> void;
+        // Window over the rows of a list, so only the rows which fit in the terminal are drawn
+        struct viewport {
+            unsigned int top;
+            unsigned int height;
+
+            // Scroll as little as possible to make the row `index` visible
+            auto scroll_to(unsigned int index) -> void;
+        };
+
+        // Viewport for a list of `count` rows printed below the question in a terminal of `rows` rows, `reserved`
+        // rows are kept below the list
+        auto fit_viewport(size_t count, unsigned int rows, unsigned int reserved = 0) -> viewport;
+
+        // Viewport for a list of `count` rows in the current terminal
+        auto list_viewport(size_t count, unsigned int reserved = 0) -> viewport;
+
+        // Fit `view` to a terminal of `rows` rows again, e.g. after a resize or when rows were added to the list
+        auto refit(viewport &view, size_t count, unsigned int rows, unsigned int reserved = 0) -> void;
+
+        // Row of a list of `count` rows reached from `row` with Home, End, Page Up or Page Down, `row` for other keys
+        auto jump(key code, unsigned int row, size_t count, unsigned int page) -> unsigned int;
+
+        auto current_theme() -> const theme &;
+
+        // Question line: `symbol` in the style `mark`, the question in the style `label` and the input symbol
+        auto print_question(std::string_view question, style mark, std::string_view symbol, style label = {}) -> void;
+
+        auto print_question(std::string_view question) -> void;
+
+        auto print_answer(std::string_view question) -> void;
+
+        // Column of the answer after print_question
+        auto answer_column(std::string_view symbol, size_t question_width) -> size_t;
 
         auto enable_raw_mode() -> void;
 
         auto disable_raw_mode() -> void;
     }// namespace utils
 
+    // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+    // Choice source
+
+    // Choices produced while a prompt is already displayed, e.g. by a thread walking a directory.
+    // Producers push the choices and close the source once done, the prompt shows them as they arrive
+    class choice_source {
+    public:
+        choice_source();
+
+        // Run `producer` on its own thread, the source is closed when it returns
+        explicit choice_source(const std::function<void(choice_source &)> &producer);
+
+        choice_source(const choice_source &)                     = delete;
+        auto operator=(const choice_source &) -> choice_source & = delete;
+
+        // Cancel the source and wait for the producer thread, if any
+        ~choice_source();
+
+        // Can be called from any thread. Returns false once the source is cancelled, the choice is dropped and the
+        // producer should stop
+        auto push(std::string choice) -> bool;
+
+        auto close() -> void;
+
+        // Tell the producer that its choices are no longer needed, e.g. the answer was picked
+        auto cancel() -> void;
+
+        auto cancelled() const -> bool;
+
+        // Move the choices pushed since the previous call at the end of `choices`, returns false if there was none
+        auto fetch(std::vector<std::string> &choices) -> bool;
+
+        // Whether the source is closed and every choice was fetched
+        auto exhausted() -> bool;
+
+        // Readable while there is something to fetch or the closing was not seen yet
+        auto fd() const -> int;
+
+    private:
+        auto signal() -> void;
+
+        std::mutex mutex;
+        std::vector<std::string> pending;
+        bool closed   = false;
+        bool signaled = false;
+        std::atomic<bool> stopped{false};
+        int pipe_fds[2];
+        std::thread producer;
+    };
+
+    // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+    // Terminal session
+
+    // Keep the terminal in raw mode for every prompt run while the session exists, so the keys typed ahead
+    // between two questions are neither echoed nor lost. The terminal is restored when the session is destroyed,
+    // also when an exception is thrown, and by SIGINT, SIGTERM, SIGHUP and SIGQUIT
+    class terminal_session {
+    public:
+        terminal_session();
+
+        // Call `observer` after each prompt of the session, instead of the global metrics observer
+        explicit terminal_session(std::function<void(const prompt_metrics &)> observer);
+
+        terminal_session(const terminal_session &)                     = delete;
+        auto operator=(const terminal_session &) -> terminal_session & = delete;
+
+        ~terminal_session();
+
+    private:
+        int exceptions;
+        bool observed = false;
+        std::function<void(const prompt_metrics &)> previous_observer;
+    };
+
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Auth
 
@@ -101,9 +881,24 @@ namespace enquirer {
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Autocomplete
 
+    enum class match_mode {
+        prefix,// Choices beginning with the answer, in alphabetical order
+        fuzzy  // Choices containing the characters of the answer in the same order, best matches first
+    };
+
     auto autocomplete(const std::string &question,
                       const std::vector<std::string> &choices = {},
-                      unsigned int limit                      = 10) -> std::string;
+                      unsigned int limit                      = 10,
+                      match_mode mode                         = match_mode::prefix) -> std::string;
+
+    auto autocomplete(const std::string &question,
+                      choice_source &source,
+                      unsigned int limit = 10,
+                      match_mode mode    = match_mode::prefix) -> std::string;
+
+    // Number of threads scoring the choices of fuzzy autocomplete on large lists, 0 for one per core and 1 (the
+    // default) to score on the calling thread only. The threads are started here and reused by every prompt
+    auto set_match_threads(unsigned int threads) -> void;
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Confirm
@@ -131,7 +926,8 @@ namespace enquirer {
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // List
 
-    auto list(const std::string &question) -> std::vector<std::string>;
+    auto list(const std::string &question,
+              const list_format &format = {}) -> std::vector<std::string>;
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // MultiSelect
@@ -145,50 +941,56 @@ namespace enquirer {
     template<typename N,
              typename = typename std::enable_if<std::is_arithmetic<N>::value>::type>
     auto number(const std::string &question) -> N {
+        utils::prompt_scope scope("number", question);
+        if (utils::headless()) {
+            const std::string answer = utils::read_answer(question);
+            if (answer.find_first_not_of(" \t") == std::string::npos) return N{};// Empty, as in the prompt
+
+            return utils::parse_number<N>(question, answer);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
         // Get answer
-        std::string answer;
-        char current;
+        utils::line_editor answer(utils::answer_column(utils::current_theme().question_symbol, utils::display_width(question)));
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (std::cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    std::cout << std::endl;
-                    break;
-                } else if (current == 127) {// Backspace
-                    if (!answer.empty()) {
-                        answer.pop_back();
-                        std::cout << utils::move_left(1);
-                        std::cout << utils::clear_line(utils::EOL);
-                    }
-                } else if (current == 27) {// Escape
-                    std::cin.get(current);
-                    if (current == 91) {
-                        std::cin.get(current);
-                        // Ignore arrow keys
-                    }
+        out.flush();
+        while (utils::read_key(key)) {
+            const char current = key.character;
+            if (key.code == utils::key::enter) {
+                N value;
+                if (!answer.empty() && !utils::to_number(answer.text(), value)) continue;// Incomplete, e.g. "1e"
+
+                out << '\n';
+                break;
+            } else if (key.code == utils::key::character && !(key.modifiers & utils::key_event::alt)) {// 'Normal' character
+                std::string typed = answer.text();
+                typed.insert(answer.cursor(), 1, current);
+                if (utils::number_prefix<N>(typed)) {
+                    answer.insert(std::string_view(&current, 1));
                 }
-            } else if (isdigit(current) ||
-                       (current == '.' && answer.find('.') == std::string::npos) ||
-                       ((current == '+' || current == '-') && answer.empty())) {// 'Normal' character
-                answer += current;
-                std::cout << current;
+            } else if (key.code != utils::key::paste && !(key.code == utils::key::control && current == '\x19')) {// No paste nor yank, their text is not checked
+                answer.edit(key);
             }
+            out.flush();
         }
         utils::disable_raw_mode();
 
         // Print resume
-        std::cout << utils::move_up()
-                  << utils::move_left(1000);
+        const std::string text = answer.text();
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        std::cout << color::cyan << answer << color::reset << std::endl;
+        out << utils::current_theme().answer << text << color::reset << '\n';
+        out.flush();
 
-        // Convert answer to number type N
-        std::stringstream ss(answer);
-        N number;
-        ss >> number;
+        // Convert answer to number type N, 0 when nothing was typed
+        N number{};
+        utils::to_number(text, number);
 
         return number;
     }
@@ -216,87 +1018,99 @@ namespace enquirer {
                 N max_value,
                 N step,
                 N initial_value) -> N {
+        utils::prompt_scope scope("slider", question);
+        if (utils::headless()) {
+            std::string answer = utils::read_answer(question);
+            if (answer.empty()) return initial_value;
+
+            N value = utils::parse_number<N>(question, answer);
+            if (value < min_value || value > max_value) {
+                throw answer_error(question + ": " + answer + " is out of range");
+            }
+            return value;
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
-        struct winsize w {};
-        ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-        const unsigned int width = std::min((unsigned int) ((max_value - min_value) / step),
-                                            (unsigned int) w.ws_col - 7);// 7 is for < > # and 2 spaces each side
-        const N swidth           = (max_value - min_value) / ((N) width);
+        const auto steps   = (unsigned int) ((max_value - min_value) / step);
+        unsigned int width = utils::slider_width(steps);
+        N swidth           = (max_value - min_value) / ((N) width);
 
         // Print value
-        N value = initial_value;
-        std::cout << std::endl
-                  << "   "
-                  << std::string((width / 2) - (std::to_string(value).length() / 2), ' ')
-                  << color::bold << value << color::reset
-                  << std::endl;
-
-        // Print slider
-        std::cout << "  " << color::cyan << color::bold << "<" << color::reset;
-        for (N i = 0; i <= (N) width; i++) {
-            N l = min_value + (i * swidth);
-            N r = min_value + ((i + 1) * swidth);
-            if (value >= l && value < r) {
-                std::cout << color::cyan << color::bold << "#" << color::reset;
-            } else {
-                std::cout << color::grey << "-" << color::reset;
-            }
-        }
-        std::cout << color::cyan << color::bold << ">" << color::reset;
+        N value      = initial_value;
+        N shown      = value;// Value of the label
+        bool resized = false;
+        out << '\n';
+        utils::slider_label(value, width);
+        out << '\n';
+
+        // Print slider, then the cursor stays at the beginning of the bar
+        int marker = utils::slider_cell(value, min_value, swidth, width);
+        utils::slider_bar(width, marker);
+        out << '\r';
 
         // Get answer
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        std::cout << utils::hide_cursor();
-        while (std::cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    break;
-                } else if (current == 27) {// Escape
-                    std::cin.get(current);
-                    if (current == 91) {
-                        std::cin.get(current);
-                        if (current == 67) {// Right
-                            value = std::min(value + step, max_value);
-                        } else if (current == 68) {// Left
-                            value = std::max(value - step, min_value);
-                        }
-                    }
-                }
+        out << utils::hide_cursor();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                break;
+            } else if (key.code == utils::key::right) {
+                value = std::min(value + step, max_value);
+            } else if (key.code == utils::key::left) {
+                value = std::max(value - step, min_value);
+            } else if (key.code == utils::key::home) {
+                value = min_value;
+            } else if (key.code == utils::key::end) {
+                value = max_value;
+            } else if (key.code == utils::key::resize) {
+                width   = utils::slider_width(steps);
+                swidth  = (max_value - min_value) / ((N) width);
+                resized = true;
             }
 
-            // Redraw slider
-            std::cout << utils::clear_line(utils::LINE)
-                      << utils::move_up() << utils::clear_line(utils::LINE)
-                      << utils::move_left(1000);
-            std::cout << "   "
-                      << std::string((width / 2) - (std::to_string(value).length() / 2), ' ')
-                      << color::bold << value << color::reset << std::endl;
-            std::cout << "  "
-                      << color::cyan << color::bold << "<" << color::reset;
-            for (unsigned int i = 0; i <= width; i++) {
-                N l = min_value + (i * swidth);
-                N r = min_value + ((i + 1) * swidth);
-                if (value >= l && value < r) {
-                    std::cout << color::cyan << color::bold << "#" << color::reset;
-                } else {
-                    std::cout << color::grey << "-" << color::reset;
+            // Only draw the value reached after the queued keys
+            if (utils::input_pending()) continue;
+
+            const int cell = utils::slider_cell(value, min_value, swidth, width);
+            if (resized) {// Draw everything again
+                out << utils::clear_line<utils::LINE>()
+                    << utils::move_up<1>() << utils::clear_line<utils::LINE>() << '\r';
+                utils::slider_label(value, width);
+                out << '\n';
+                utils::slider_bar(width, cell);
+                out << '\r';
+                resized = false;
+            } else {// Only the cells of the marker and the value
+                if (cell != marker) {
+                    utils::move_slider_marker(marker, cell);
+                }
+                if (value != shown) {
+                    out << utils::move_up<1>() << utils::clear_line<utils::LINE>();
+                    utils::slider_label(value, width);
+                    out << utils::move_down<1>() << '\r';
                 }
             }
-            std::cout << color::cyan << color::bold << ">" << color::reset;
+            marker = cell;
+            shown  = value;
+            out.flush();
         }
-        std::cout << utils::show_cursor();
+        out << utils::show_cursor();
         utils::disable_raw_mode();
 
         // Print resume
-        std::cout << utils::clear_line(utils::LINE)
-                  << utils::move_up() << utils::clear_line(utils::LINE)
-                  << utils::move_up() << utils::clear_line(utils::LINE)
-                  << utils::move_left(1000);
+        out << utils::clear_line<utils::LINE>()
+            << utils::move_up<1>() << utils::clear_line<utils::LINE>()
+            << utils::move_up<1>() << utils::clear_line<utils::LINE>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        std::cout << color::cyan << value << color::reset << std::endl;
+        out << utils::current_theme().answer << value << color::reset << '\n';
+        out.flush();
 
         return value;
     }
@@ -307,6 +1121,9 @@ namespace enquirer {
     auto select(const std::string &question,
                 const std::vector<std::string> &choices) -> std::string;
 
+    auto select(const std::string &question,
+                choice_source &source) -> std::string;
+
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Toggle
 
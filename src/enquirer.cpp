@@ -21,389 +21,2512 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <enquirer.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <poll.h>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <sys/ioctl.h>
 #include <termios.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
-namespace enquirer {
+namespace enquirer {
+
+    // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+    // Utilities
+
+    static flush_policy current_flush_policy = flush_policy::frame;
+    static prompt_mode current_prompt_mode   = prompt_mode::automatic;
+    static function<void(const prompt_metrics &)> metrics_observer;
+    static theme active_theme;
+
+    static streambuf *const stdin_buffer = cin.rdbuf();
+
+    auto set_flush_policy(flush_policy policy) -> void {
+        utils::out().flush();
+        current_flush_policy = policy;
+    }
+
+    auto set_prompt_mode(prompt_mode mode) -> void {
+        current_prompt_mode = mode;
+    }
+
+    auto set_metrics_observer(function<void(const prompt_metrics &)> observer) -> void {
+        metrics_observer = std::move(observer);
+    }
+
+    auto set_theme(const theme &value) -> void {
+        active_theme = value;
+    }
+
+    namespace utils {
+        // Metrics of the running prompt, null when they are not collected
+        static prompt_metrics *active_metrics = nullptr;
+
+        prompt_scope::prompt_scope(string_view prompt, const string &question)
+            : enabled(static_cast<bool>(metrics_observer)),
+              outer(active_metrics) {
+            if (!enabled) return;
+
+            metrics.prompt   = prompt;
+            metrics.question = question;
+            active_metrics   = &metrics;
+            start            = chrono::steady_clock::now();
+        }
+
+        prompt_scope::~prompt_scope() {
+            if (!enabled) return;
+
+            metrics.wall      = chrono::steady_clock::now() - start;
+            metrics.rendering = metrics.wall - metrics.waiting - metrics.matching;
+            active_metrics    = outer;
+            if (metrics_observer) {
+                metrics_observer(metrics);
+            }
+        }
+
+        // Add the time spent until the end of the scope to a duration of the active metrics
+        class stopwatch {
+        public:
+            explicit stopwatch(chrono::nanoseconds prompt_metrics::*duration)
+                : duration(duration) {
+                if (active_metrics != nullptr) {
+                    start = chrono::steady_clock::now();
+                }
+            }
+
+            ~stopwatch() {
+                if (active_metrics != nullptr) {
+                    active_metrics->*duration += chrono::steady_clock::now() - start;
+                }
+            }
+
+        private:
+            chrono::nanoseconds prompt_metrics::*duration;
+            chrono::steady_clock::time_point start;
+        };
+
+        auto frame_buffer::operator<<(string_view str) -> frame_buffer & {
+            buffer.append(str);
+            return *this;
+        }
+
+        auto frame_buffer::operator<<(char c) -> frame_buffer & {
+            buffer.push_back(c);
+            return *this;
+        }
+
+        auto frame_buffer::operator<<(control_sequence seq) -> frame_buffer & {
+            char str[control_sequence::max_size];
+            buffer.append(str, seq.write(str));
+            return *this;
+        }
+
+        auto frame_buffer::fill(size_t count, char c) -> frame_buffer & {
+            buffer.append(count, c);
+            return *this;
+        }
+
+        auto frame_buffer::flush() -> void {
+            if (buffer.empty()) {
+                return;
+            }
+
+            if (active_metrics != nullptr) {
+                active_metrics->frames++;
+                active_metrics->bytes += buffer.size();
+            }
+
+            if (current_flush_policy == flush_policy::stream) {
+                cout.write(buffer.data(), (streamsize) buffer.size());
+                cout.flush();
+            } else {
+                cout.flush();// Keep the order with what was written to std::cout before
+                const char *data = buffer.data();
+                size_t remaining = buffer.size();
+                while (remaining > 0) {
+                    ssize_t written = write(STDOUT_FILENO, data, remaining);
+                    if (active_metrics != nullptr) {
+                        active_metrics->syscalls++;
+                    }
+                    if (written < 0) {
+                        if (errno == EINTR) continue;
+                        break;
+                    }
+                    data += written;
+                    remaining -= written;
+                }
+            }
+            buffer.clear();// Keep capacity for the next frame
+        }
+
+        auto out() -> frame_buffer & {
+            static frame_buffer buffer;
+            return buffer;
+        }
+
+        auto operator<<(ostream &os, control_sequence seq) -> ostream & {
+            char str[control_sequence::max_size];
+            return os.write(str, seq.write(str) - str);
+        }
+
+        auto current_theme() -> const theme & {
+            return active_theme;
+        }
+
+        static auto print_line(string_view question, style mark, string_view symbol, style label, string_view input) -> void {
+            auto &out = utils::out();
+            out << clear_line<LINE>();
+            out << mark << symbol
+                << color::reset << label << question << color::reset
+                << " " << active_theme.separator << input
+                << color::reset;
+        }
+
+        auto print_question(string_view question, style mark, string_view symbol, style label) -> void {
+            print_line(question, mark, symbol, label, active_theme.input_symbol);
+        }
+
+        auto print_question(string_view question) -> void {
+            print_line(question, active_theme.question, active_theme.question_symbol, {}, active_theme.input_symbol);
+        }
+
+        auto print_answer(string_view question) -> void {
+            print_line(question, active_theme.answered, active_theme.answered_symbol, {}, active_theme.answer_symbol);
+        }
+
+        auto answer_column(string_view symbol, size_t question_width) -> size_t {
+            return display_width(symbol) + question_width + 1 + display_width(active_theme.input_symbol);
+        }
+
+        // Set by SIGWINCH, for the size cache and for the decoder which reports the resize as a key
+        static volatile sig_atomic_t size_stale     = 1;
+        static volatile sig_atomic_t resize_pending = 0;
+        // Written by SIGWINCH to wake up the decoder waiting for a key
+        static int resize_pipe[2]                   = {-1, -1};
+        static struct sigaction previous_winch {};
+
+        static auto on_resize(int signal, siginfo_t *info, void *context) -> void {
+            const int saved_errno = errno;
+            size_stale            = 1;
+            resize_pending        = 1;
+            if (resize_pipe[1] >= 0) {
+                const char byte = 1;
+                [[maybe_unused]] auto written = write(resize_pipe[1], &byte, 1);
+            }
+            errno = saved_errno;
+
+            // The previous action of the program, with the arguments of its kind
+            if (previous_winch.sa_flags & SA_SIGINFO) {
+                if (previous_winch.sa_sigaction != nullptr) {
+                    previous_winch.sa_sigaction(signal, info, context);
+                }
+            } else if (previous_winch.sa_handler != SIG_DFL && previous_winch.sa_handler != SIG_IGN) {
+                previous_winch.sa_handler(signal);
+            }
+        }
+
+        // Drain the wake-up bytes of the resizes already seen
+        static auto drain_resize_pipe() -> void {
+            char bytes[16];
+            while (read(resize_pipe[0], bytes, sizeof(bytes)) > 0) {}
+        }
+
+        auto terminal_size() -> winsize {
+            static struct winsize size {};
+            static bool watching = false;
+            if (!watching) {// Install the SIGWINCH handler once
+                watching = true;
+                if (pipe(resize_pipe) == 0) {
+                    for (int fd: resize_pipe) {
+                        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                        fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    }
+                }
+                struct sigaction action {};
+                action.sa_sigaction = on_resize;
+                action.sa_flags     = SA_RESTART | SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGWINCH, &action, &previous_winch);
+            }
+
+            if (size_stale) {
+                size_stale = 0;
+                if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0) {
+                    size = {};
+                }
+            }
+            return size;
+        }
+
+        // Keys of the bytes outside escape sequences
+        constexpr auto byte_keys() -> array<key, 128> {
+            array<key, 128> keys{};
+            for (unsigned int i = 0; i < keys.size(); i++) {
+                keys[i] = (i < 32) ? key::control : key::character;
+            }
+            keys['\t']   = key::tab;
+            keys['\n']   = key::enter;
+            keys['\r']   = key::enter;
+            keys['\b']   = key::backspace;
+            keys[127]    = key::backspace;
+            keys['\033'] = key::escape;
+            return keys;
+        }
+
+        // Keys of the final byte of `ESC [ params final` (CSI) and `ESC O final` (SS3) sequences
+        constexpr auto final_keys() -> array<key, 128> {
+            array<key, 128> keys{};
+            for (auto &k: keys) {
+                k = key::unknown;
+            }
+            keys['A'] = key::up;
+            keys['B'] = key::down;
+            keys['C'] = key::right;
+            keys['D'] = key::left;
+            keys['H'] = key::home;
+            keys['F'] = key::end;
+            keys['Z'] = key::tab;// Shift+Tab
+            return keys;
+        }
+
+        // Keys of `ESC [ n ~` sequences, by n
+        constexpr array<key, 9> tilde_keys = {key::unknown, key::home, key::insert, key::del, key::end,
+                                              key::page_up, key::page_down, key::home, key::end};
+
+        // Decode the keys of the bytes read by chunks from stdin, or from std::cin when it is redirected
+        class input_decoder {
+        public:
+            // Delay after which an escape not followed by the rest of a sequence is the Escape key
+            static constexpr int escape_delay = 25;// ms
+
+            auto next(key_event &event) -> bool {
+                if (cin.rdbuf() != source) {// The buffered bytes belong to the previous input
+                    source  = cin.rdbuf();
+                    begin   = 0;
+                    end     = 0;
+                    pasting = false;
+                }
+
+                while (true) {
+                    if (resize_pending && !pasting) {
+                        resize_pending = 0;
+                        drain_resize_pipe();
+                        event = {key::resize};
+                        return true;
+                    }
+
+                    if (pasting) {
+                        if (collect_paste()) {
+                            event.code      = key::paste;
+                            event.character = 0;
+                            event.modifiers = 0;
+                            event.text.swap(pasted);
+                            return true;
+                        }
+                    } else {
+                        size_t length = decode(buffer + begin, end - begin, event);
+                        if (length > 0) {
+                            begin += length;
+                            if (event.code != key::paste) return true;
+
+                            pasting = true;// Beginning of a paste, the text follows
+                            pasted.clear();
+                            continue;
+                        }
+                    }
+
+                    const bool partial = !pasting && begin < end;
+                    if (!fill(partial)) {
+                        if (pasting) {// The end of the paste will never come, keep what was received
+                            pasted.append(buffer + begin, end - begin);
+                            begin   = end;
+                            pasting = false;
+                            event   = {key::paste};
+                            event.text.swap(pasted);
+                            return true;
+                        }
+                        if (!partial) return false;
+
+                        // The sequence will not be completed, the escape was a key on its own
+                        event = {key::escape, '\033'};
+                        begin++;
+                        return true;
+                    }
+                }
+            }
+
+            // Whether bytes are buffered, the next key may not need a read
+            auto buffered() const -> bool {
+                return cin.rdbuf() == source && begin < end;
+            }
+
+        private:
+            // Longest sequence decoded, longer ones are skipped
+            static constexpr size_t max_sequence = 32;
+
+            static constexpr string_view paste_end = "\033[201~";
+
+            // Move the buffered pasted text to `pasted`, returns true once the end of the paste is reached
+            auto collect_paste() -> bool {
+                string_view data(buffer + begin, end - begin);
+                size_t found = data.find(paste_end);
+                if (found != string_view::npos) {
+                    pasted.append(data.substr(0, found));
+                    begin += found + paste_end.size();
+                    pasting = false;
+                    return true;
+                }
+
+                // Keep the bytes which may be the beginning of the end sequence
+                size_t length = data.size() - min(data.size(), paste_end.size() - 1);
+                pasted.append(data.substr(0, length));
+                begin += length;
+                return false;
+            }
+
+            static constexpr array<key, 128> bytes  = byte_keys();
+            static constexpr array<key, 128> finals = final_keys();
+
+            // Decode the key at the beginning of `data`, returns its length or 0 if the sequence is incomplete
+            static auto decode(const char *data, size_t size, key_event &event) -> size_t {
+                enum { ground,
+                       escape,
+                       csi,
+                       ss3 } state       = ground;
+                unsigned int params[2] = {0, 0};
+                unsigned int param     = 0;
+
+                for (size_t i = 0; i < min(size, max_sequence); i++) {
+                    const auto byte = (unsigned char) data[i];
+                    switch (state) {
+                        case ground:
+                            if (byte == '\033') {
+                                state = escape;
+                                break;
+                            }
+                            event = {byte < 128 ? bytes[byte] : key::character, (char) byte};
+                            return 1;
+                        case escape:
+                            if (byte == '[') {
+                                state = csi;
+                            } else if (byte == 'O') {
+                                state = ss3;
+                            } else if (byte == '\033') {
+                                event = {key::escape, '\033'};
+                                return 1;
+                            } else {// Alt+key
+                                event = {byte < 128 ? bytes[byte] : key::character, (char) byte, key_event::alt};
+                                return 2;
+                            }
+                            break;
+                        case csi:
+                            if (byte >= '0' && byte <= '9') {
+                                if (param < 2) {
+                                    params[param] = min(params[param] * 10 + (byte - '0'), 1000U);
+                                }
+                            } else if (byte == ';') {
+                                param++;
+                            } else if (byte >= 0x40 && byte <= 0x7E) {// Final byte
+                                if (byte == '~' && params[0] == 200) {// Beginning of a paste
+                                    event.code = key::paste;
+                                } else if (byte == '~') {
+                                    event.code = (params[0] < tilde_keys.size()) ? tilde_keys[params[0]] : key::unknown;
+                                } else {
+                                    event.code = finals[byte];
+                                }
+                                event.character = 0;
+                                event.modifiers = (params[1] > 1) ? ((params[1] - 1) & 7) : 0;
+                                if (byte == 'Z') {
+                                    event.modifiers |= key_event::shift;
+                                }
+                                return i + 1;
+                            } else if (byte < 0x20 || byte > 0x3F) {// Malformed, skip up to this byte
+                                event = {key::unknown};
+                                return i;
+                            }
+                            break;
+                        case ss3:
+                            event = {byte < 128 ? finals[byte] : key::unknown};
+                            return i + 1;
+                    }
+                }
+
+                if (size >= max_sequence) {
+                    event = {key::unknown};
+                    return max_sequence;
+                }
+                return 0;
+            }
+
+            // Read the available bytes, waiting at most escape_delay when completing a `partial` sequence.
+            // Returns false at the end of the input or when the delay expired
+            auto fill(bool partial) -> bool {
+                if (begin > 0) {
+                    memmove(buffer, buffer + begin, end - begin);
+                    end -= begin;
+                    begin = 0;
+                }
+
+                const auto space = (streamsize) (sizeof(buffer) - end);
+                streamsize count;
+                if (source != stdin_buffer) {// Byte by byte, the bytes after the last key stay in std::cin
+                    if (partial && source->in_avail() <= 0) return false;
+                    count = source->sgetn(buffer + end, 1);
+                } else {
+                    if (partial) {
+                        struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+                        if (poll(&fd, 1, escape_delay) <= 0) return false;
+                    } else {// Wait for a key or a resize, a resize during a paste is reported once it ends
+                        struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {resize_pipe[0], POLLIN, 0}};
+                        const nfds_t count   = pasting ? 1 : 2;
+                        while (poll(fds, count, -1) < 0 && errno == EINTR) {}
+                        if (fds[0].revents == 0 && count == 2 && fds[1].revents != 0) return true;// Reported by next()
+                    }
+                    do {
+                        count = read(STDIN_FILENO, buffer + end, space);
+                    } while (count < 0 && errno == EINTR);
+                }
+                if (count <= 0) return false;
+
+                end += count;
+                return true;
+            }
+
+            streambuf *source = nullptr;
+            char buffer[4096];
+            size_t begin = 0;
+            size_t end   = 0;
+            bool pasting = false;
+            string pasted;
+        };
+
+        static input_decoder keyboard;
+
+        auto read_key(key_event &event) -> bool {
+            if (active_metrics == nullptr) {
+                return keyboard.next(event);
+            }
+
+            stopwatch timer(&prompt_metrics::waiting);
+            bool read = keyboard.next(event);
+            if (read && event.code != key::resize) {
+                active_metrics->keystrokes++;
+            }
+            return read;
+        }
+
+        auto input_pending() -> bool {
+            if (keyboard.buffered()) return true;
+            if (cin.rdbuf() != stdin_buffer) return cin.rdbuf()->in_avail() > 0;
+
+            struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+            return poll(&fd, 1, 0) > 0;
+        }
+
+        auto headless() -> bool {
+            static const bool terminal = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+            return current_prompt_mode == prompt_mode::headless ||
+                   (current_prompt_mode == prompt_mode::automatic && !terminal);
+        }
+
+        auto read_answer(const string &key) -> string {
+            string line;
+            if (!getline(cin, line)) {
+                throw answer_error(key + ": no answer");
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.size() > key.size() && line[key.size()] == '=' && line.compare(0, key.size(), key) == 0) {
+                line.erase(0, key.size() + 1);
+            }
+
+            return line;
+        }
+
+        // Index of `answer` in `choices`, throws answer_error if it is not one of them
+        auto find_choice(const string &question, const vector<string> &choices, const string &answer) -> size_t {
+            auto it = find(choices.begin(), choices.end(), answer);
+            if (it == choices.end()) {
+                throw answer_error(question + ": '" + answer + "' is not a choice");
+            }
+
+            return it - choices.begin();
+        }
+
+        // Yes/no answer, throws answer_error if it is neither
+        auto parse_yes_no(const string &question, string answer) -> bool {
+            transform(answer.begin(), answer.end(), answer.begin(), [](unsigned char c) { return tolower(c); });
+            if (answer == "y" || answer == "yes" || answer == "true" || answer == "1") return true;
+            if (answer == "n" || answer == "no" || answer == "false" || answer == "0") return false;
+
+            throw answer_error(question + ": '" + answer + "' is neither yes nor no");
+        }
+
+        // Choices of a prompt which arrive from a choice_source while it is displayed
+        struct choice_stream {
+            // Minimum delay between two refreshes caused by new choices
+            static constexpr chrono::milliseconds refresh_delay{50};
+
+            choice_source *source = nullptr;
+            vector<string> *choices = nullptr;
+            chrono::steady_clock::time_point last_fetch;
+
+            auto loading() const -> bool {
+                return source != nullptr && !source->exhausted();
+            }
+
+            // Move the new choices to the list, returns false if there was none or the last fetch is too recent
+            auto fetch() -> bool {
+                if (source == nullptr) return false;
+
+                auto now = chrono::steady_clock::now();
+                if (now - last_fetch < refresh_delay && !source->exhausted()) return false;
+
+                last_fetch = now;
+                return source->fetch(*choices);
+            }
+        };
+
+        // Wait until a key can be read or new choices arrived in `stream`, returns whether a key is ready
+        auto wait_key(choice_stream &stream) -> bool {
+            if (!stream.loading() || input_pending() || cin.rdbuf() != stdin_buffer) {
+                return true;
+            }
+
+            stopwatch timer(&prompt_metrics::waiting);
+            while (true) {
+                auto elapsed      = chrono::steady_clock::now() - stream.last_fetch;
+                int timeout       = -1;
+                struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {stream.source->fd(), POLLIN, 0}};
+                nfds_t count      = 2;
+                if (elapsed < choice_stream::refresh_delay) {// Too early to refresh, only wait for a key
+                    timeout = (int) chrono::duration_cast<chrono::milliseconds>(choice_stream::refresh_delay - elapsed).count() + 1;
+                    count   = 1;
+                }
+
+                int ready = poll(fds, count, timeout);
+                if (ready < 0 && errno != EINTR) return true;
+                if (fds[0].revents != 0) return true;
+                if (count == 2 && fds[1].revents != 0) return false;
+            }
+        }
+
+        // Raw mode is entered by the outermost enable_raw_mode and left by the matching disable_raw_mode, nested
+        // calls (a prompt inside a terminal_session) keep the terminal as it is
+        static unsigned int raw_mode_depth = 0;
+        static struct termios original_term {};
+        static bool term_saved = false;
+
+        // Signals restoring the terminal before their previous action
+        static constexpr array<int, 4> restoring_signals = {SIGINT, SIGTERM, SIGHUP, SIGQUIT};
+        static struct sigaction previous_actions[restoring_signals.size()];
+
+        static auto restore_terminal(int signal) -> void {
+            if (term_saved) {
+                tcsetattr(STDIN_FILENO, TCSANOW, &original_term);
+            }
+            constexpr string_view reset = "\033[?25h\033[?2004l";// Show cursor, disable paste
+            [[maybe_unused]] auto written = write(STDOUT_FILENO, reset.data(), reset.size());
+
+            // Run the previous action once this handler returns
+            for (unsigned int i = 0; i < restoring_signals.size(); i++) {
+                if (restoring_signals[i] == signal) {
+                    sigaction(signal, &previous_actions[i], nullptr);
+                }
+            }
+            raise(signal);
+        }
+
+        auto enable_raw_mode() -> void {
+            if (raw_mode_depth++ > 0) return;
+
+            term_saved = tcgetattr(STDIN_FILENO, &original_term) == 0;
+            if (!term_saved) return;// Not a terminal
+
+            struct sigaction action {};
+            action.sa_handler = restore_terminal;
+            sigemptyset(&action.sa_mask);
+            for (unsigned int i = 0; i < restoring_signals.size(); i++) {
+                sigaction(restoring_signals[i], &action, &previous_actions[i]);
+            }
+
+            // TCSANOW keeps what was typed ahead, it is read by the prompt
+            struct termios term = original_term;
+            term.c_lflag &= ~(ECHO | ICANON);
+            tcsetattr(STDIN_FILENO, TCSANOW, &term);
+        }
+
+        // Leave raw mode whatever its depth, the prompts unwound by an exception did not call disable_raw_mode
+        static auto reset_raw_mode() -> void {
+            raw_mode_depth = 0;
+            if (!term_saved) return;
+
+            tcsetattr(STDIN_FILENO, TCSANOW, &original_term);
+            for (unsigned int i = 0; i < restoring_signals.size(); i++) {
+                sigaction(restoring_signals[i], &previous_actions[i], nullptr);
+            }
+            term_saved = false;
+        }
+
+        auto disable_raw_mode() -> void {
+            if (raw_mode_depth == 0 || --raw_mode_depth > 0) return;
+            reset_raw_mode();
+        }
+
+        // Append the pasted `text` to the single line `answer` without its control characters, e.g. line breaks.
+        // Returns the part appended
+        auto append_pasted(string &answer, const string &text) -> string_view {
+            const size_t length = answer.size();
+            answer.reserve(length + text.size());
+            for (char c: text) {
+                if (!iscntrl((unsigned char) c)) {
+                    answer += c;
+                }
+            }
+
+            return string_view(answer).substr(length);
+        }
+
+        // Code points between first and last, both included
+        struct code_range {
+            char32_t first;
+            char32_t last;
+        };
+
+        // Combining marks and format characters, drawn over the previous character
+        static constexpr code_range zero_width[] = {
+                {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+                {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670},
+                {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0711, 0x0711},
+                {0x0730, 0x074A}, {0x07A6, 0x07B0}, {0x0900, 0x0902}, {0x093A, 0x093A}, {0x093C, 0x093C},
+                {0x0941, 0x0948}, {0x094D, 0x094D}, {0x0951, 0x0957}, {0x0962, 0x0963}, {0x0E31, 0x0E31},
+                {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1160, 0x11FF}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+                {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0x302A, 0x302D},
+                {0x3099, 0x309A}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0xE0001, 0xE0001},
+                {0xE0020, 0xE007F}, {0xE0100, 0xE01EF}};
+
+        // East Asian wide and fullwidth characters, and the emoji presented as wide
+        static constexpr code_range wide[] = {
+                {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+                {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+                {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+                {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+                {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+                {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+                {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+                {0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+                {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F},
+                {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B2FF},
+                {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251},
+                {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA},
+                {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F43E}, {0x1F440, 0x1F440},
+                {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A},
+                {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC},
+                {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB},
+                {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+                {0x30000, 0x3FFFD}};
+
+        template<size_t N>
+        static auto in_ranges(char32_t c, const code_range (&ranges)[N]) -> bool {
+            auto it = upper_bound(begin(ranges), end(ranges), c, [](char32_t c, const code_range &range) {
+                return c < range.first;
+            });
+            return it != begin(ranges) && c <= prev(it)->last;
+        }
+
+        // Columns of a code point: 0 for the control characters and the combining marks, 2 for the wide characters
+        static auto char_width(char32_t c) -> unsigned int {
+            if (c < 0x20 || (c >= 0x7F && c < 0xA0)) return 0;
+            if (c < 0x300) return 1;
+            if (in_ranges(c, zero_width)) return 0;
+            return in_ranges(c, wide) ? 2 : 1;
+        }
+
+        // Decode the UTF-8 character at the beginning of `text` and set its `length`.
+        // An invalid or truncated sequence decodes as one byte of U+FFFD
+        static auto decode_utf8(string_view text, size_t &length) -> char32_t {
+            const auto lead = (unsigned char) text[0];
+            length          = (lead < 0x80) ? 1 : (lead >= 0xF0) ? 4 : (lead >= 0xE0) ? 3 : (lead >= 0xC0) ? 2 : 0;
+            if (length == 0 || length > text.size()) {
+                length = 1;
+                return 0xFFFD;
+            }
+
+            char32_t c = (length == 1) ? lead : lead & (0x7F >> length);
+            for (size_t i = 1; i < length; i++) {
+                const auto byte = (unsigned char) text[i];
+                if ((byte & 0xC0) != 0x80) {
+                    length = 1;
+                    return 0xFFFD;
+                }
+                c = (c << 6) | (byte & 0x3F);
+            }
+            return c;
+        }
+
+        auto display_width(string_view text) -> size_t {
+            size_t width = 0;
+            size_t i     = 0;
+            while (i < text.size()) {
+                // Printable ASCII, 8 bytes at a time: no byte has its high bit set or is below 0x20
+                while (i + 8 <= text.size()) {
+                    uint64_t word;
+                    memcpy(&word, text.data() + i, 8);
+                    if (((word - 0x2020202020202020) | word) & 0x8080808080808080) break;
+                    width += 8;
+                    i += 8;
+                }
+                if (i == text.size()) break;
+
+                size_t length;
+                width += char_width(decode_utf8(text.substr(i), length));
+                i += length;
+            }
+
+            return width;
+        }
+
+        // Continuation bytes of UTF-8 characters do not start a character
+        static auto continuation(char c) -> bool {
+            return ((unsigned char) c & 0xC0) == 0x80;
+        }
+
+        // Characters of a text, one mask character is printed for each when it is hidden
+        static auto char_count(string_view text) -> size_t {
+            return count_if(text.begin(), text.end(), [](char c) { return !continuation(c); });
+        }
+
+        // Remove the last character of `text`, with its combining marks
+        static auto pop_char(string &text) -> void {
+            while (!text.empty()) {
+                size_t start = text.size() - 1;
+                while (start > 0 && continuation(text[start])) start--;
+
+                size_t length;
+                const bool mark = char_width(decode_utf8(string_view(text).substr(start), length)) == 0;
+                text.resize(start);
+                if (!mark) break;
+            }
+        }
+
+        // Letters, digits and the non ASCII characters are part of words
+        static auto word_byte(char c) -> bool {
+            return isalnum((unsigned char) c) || (unsigned char) c >= 0x80;
+        }
+
+        // Columns left for an answer beginning at the column `origin`, the last column is kept free so the row never
+        // wraps. 0 when the size of the terminal is unknown or the question does not leave room for the answer
+        static auto answer_width(size_t origin) -> size_t {
+            const size_t columns = terminal_size().ws_col;
+            return (columns > origin + 1) ? columns - origin - 1 : 0;
+        }
+
+        // Bytes at the beginning of `text` which fit in `room` columns, `used` is set to their columns.
+        // A masked text takes one column per character
+        static auto fit_columns(string_view text, size_t room, bool masked, size_t &used) -> size_t {
+            if (text.size() * 2 <= room) {// Fits whatever its characters
+                used = masked ? char_count(text) : display_width(text);
+                return text.size();
+            }
+
+            used     = 0;
+            size_t i = 0;
+            while (i < text.size()) {
+                size_t length;
+                const char32_t c      = decode_utf8(text.substr(i), length);
+                const unsigned int cw = masked ? !continuation(text[i]) : char_width(c);
+                if (used + cw > room) break;
+                used += cw;
+                i += length;
+            }
+            return i;
+        }
+
+        line_editor::line_editor(size_t origin, echo mode, char mask)
+            : mode(mode), mask(mask), origin(origin), width(answer_width(origin)) {}
+
+        auto line_editor::edit(const key_event &key) -> bool {
+            const bool alt = key.modifiers & key_event::alt;
+            const bool ctrl = key.modifiers & key_event::ctrl;
+            const size_t position = cursor();
+            const char c = key.character;
+            if (key.code == key::character && !alt) {
+                insert(string_view(&c, 1));
+            } else if (key.code == key::paste) {
+                insert(key.text);
+            } else if (key.code == key::left || (key.code == key::control && c == '\x02')) {
+                move_to(ctrl ? previous_word(position) : previous_char(position));
+            } else if (key.code == key::right || (key.code == key::control && c == '\x06')) {
+                move_to(ctrl ? next_word(position) : next_char(position));
+            } else if (key.code == key::home || (key.code == key::control && c == '\x01')) {
+                move_to(0);
+            } else if (key.code == key::end || (key.code == key::control && c == '\x05')) {
+                move_to(size());
+            } else if (key.code == key::character && (c == 'b' || c == 'B')) {// Alt+B
+                move_to(previous_word(position));
+            } else if (key.code == key::character && (c == 'f' || c == 'F')) {// Alt+F
+                move_to(next_word(position));
+            } else if (key.code == key::backspace && alt) {
+                erase(previous_word(position), position, true);
+            } else if (key.code == key::backspace) {
+                erase(previous_char(position), position, false);
+            } else if (key.code == key::del || (key.code == key::control && c == '\x04')) {
+                erase(position, next_char(position), false);
+            } else if (key.code == key::character && (c == 'd' || c == 'D')) {// Alt+D
+                erase(position, next_word(position), true);
+            } else if (key.code == key::control && c == '\x0B') {// Ctrl+K
+                erase(position, size(), true);
+            } else if (key.code == key::control && c == '\x15') {// Ctrl+U
+                erase(0, position, true);
+            } else if (key.code == key::control && c == '\x17') {// Ctrl+W
+                erase(previous_word(position), position, true);
+            } else if (key.code == key::control && c == '\x19') {// Ctrl+Y
+                insert(string(killed));
+            } else if (key.code == key::resize) {
+                width = answer_width(origin);
+                if (mode != echo::none && width != 0) {
+                    scroll_to_cursor();
+                    redraw();
+                }
+            } else {
+                return false;
+            }
+
+            return true;
+        }
+
+        auto line_editor::insert(string_view text) -> void {
+            size_t length = 0;
+            for (char c: text) {
+                length += !iscntrl((unsigned char) c);
+            }
+            if (length == 0) return;
+
+            if (gap_end - gap_begin < length) {// Grow the gap, at least doubling the buffer
+                const size_t after = buffer.size() - gap_end;
+                const size_t grown = max(buffer.size() * 2, size() + length + 16);
+                string larger(grown, '\0');
+                memcpy(&larger[0], buffer.data(), gap_begin);
+                memcpy(&larger[grown - after], buffer.data() + gap_end, after);
+                buffer.swap(larger);
+                gap_end = grown - after;
+            }
+
+            const size_t from = gap_begin;
+            for (char c: text) {
+                if (!iscntrl((unsigned char) c)) {
+                    buffer[gap_begin++] = c;
+                }
+            }
+
+            if (mode == echo::none) return;
+            if (!visible(gap_begin)) {// Pushed out of the row
+                scroll_to_cursor();
+                redraw();
+                return;
+            }
+
+            if (mode == echo::text) {
+                out() << string_view(buffer.data() + from, gap_begin - from);
+            } else {
+                out().fill(columns(from, gap_begin), mask);
+            }
+            if (gap_end != buffer.size() || !hint.empty()) {
+                redraw_tail();
+            }
+        }
+
+        auto line_editor::set_hint(string text) -> void {
+            if (text == hint) return;
+
+            hint.swap(text);
+            if (mode != echo::none) {
+                redraw_tail();
+            }
+        }
+
+        auto line_editor::text() const -> string {
+            string result;
+            result.reserve(size());
+            result.append(buffer, 0, gap_begin);
+            result.append(buffer, gap_end, string::npos);
+            return result;
+        }
+
+        auto line_editor::append_to(string &dest, size_t from) const -> void {
+            if (from < gap_begin) {
+                dest.append(buffer, from, gap_begin - from);
+            }
+            const size_t after = gap_end + (max(from, gap_begin) - gap_begin);
+            dest.append(buffer, after, buffer.size() - after);
+        }
+
+        auto line_editor::size() const -> size_t {
+            return buffer.size() - (gap_end - gap_begin);
+        }
+
+        auto line_editor::empty() const -> bool {
+            return size() == 0;
+        }
+
+        auto line_editor::cursor() const -> size_t {
+            return gap_begin;
+        }
+
+        auto line_editor::at(size_t i) const -> char {
+            return (i < gap_begin) ? buffer[i] : buffer[i + (gap_end - gap_begin)];
+        }
+
+        auto line_editor::move_gap(size_t position) -> void {
+            if (position < gap_begin) {
+                const size_t count = gap_begin - position;
+                memmove(&buffer[gap_end - count], &buffer[position], count);
+                gap_begin -= count;
+                gap_end -= count;
+            } else if (position > gap_begin) {
+                const size_t count = position - gap_begin;
+                memmove(&buffer[gap_begin], &buffer[gap_end], count);
+                gap_begin += count;
+                gap_end += count;
+            }
+        }
+
+        auto line_editor::move_to(size_t position) -> void {
+            const size_t from = cursor();
+            if (mode != echo::none && !visible(position)) {
+                move_gap(position);
+                scroll_to_cursor();
+                redraw();
+                return;
+            }
+            if (mode != echo::none) {// A count of 0 moves by one column, nothing is written for zero width text
+                const size_t crossed = (position < from) ? columns(position, from) : columns(from, position);
+                if (crossed > 0 && position < from) {
+                    out() << move_left(crossed);
+                } else if (crossed > 0) {
+                    out() << move_right(crossed);
+                }
+            }
+            move_gap(position);
+        }
+
+        auto line_editor::erase(size_t from, size_t to, bool kill) -> void {
+            if (from >= to) return;
+
+            move_to(from);
+            if (kill) {
+                killed.clear();
+                killed.reserve(to - from);
+                for (size_t i = from; i < to; i++) {
+                    killed += at(i);
+                }
+            }
+            gap_end += to - from;
+            if (mode != echo::none) {
+                redraw_tail();
+            }
+        }
+
+        auto line_editor::code_point(size_t i) const -> char32_t {
+            char bytes[4];
+            size_t count = 0;
+            for (; count < 4 && i + count < size(); count++) {
+                bytes[count] = at(i + count);
+            }
+            size_t length;
+            return decode_utf8(string_view(bytes, count), length);
+        }
+
+        auto line_editor::previous_char(size_t i) const -> size_t {
+            while (i > 0) {// Combining marks go with the character before them
+                while (i > 0 && continuation(at(--i))) {}
+                if (char_width(code_point(i)) != 0) break;
+            }
+            return i;
+        }
+
+        auto line_editor::next_char(size_t i) const -> size_t {
+            if (i >= size()) return size();
+            do {
+                while (++i < size() && continuation(at(i))) {}
+            } while (i < size() && char_width(code_point(i)) == 0);
+            return i;
+        }
+
+        auto line_editor::previous_word(size_t i) const -> size_t {
+            while (i > 0 && !word_byte(at(i - 1))) i--;
+            while (i > 0 && word_byte(at(i - 1))) i--;
+            return i;
+        }
+
+        auto line_editor::next_word(size_t i) const -> size_t {
+            while (i < size() && !word_byte(at(i))) i++;
+            while (i < size() && word_byte(at(i))) i++;
+            return i;
+        }
+
+        auto line_editor::columns(size_t from, size_t to) const -> size_t {
+            auto measure = (mode == echo::mask) ? char_count : display_width;
+            size_t total = 0;
+            if (from < gap_begin) {
+                total += measure(string_view(buffer.data() + from, min(to, gap_begin) - from));
+            }
+            if (to > gap_begin) {
+                const size_t start = max(from, gap_begin);
+                total += measure(string_view(buffer.data() + start + (gap_end - gap_begin), to - start));
+            }
+            return total;
+        }
+
+        auto line_editor::visible(size_t position) const -> bool {
+            return width == 0 || (position >= scroll && columns(scroll, position) < width);
+        }
+
+        auto line_editor::scroll_to_cursor() -> void {
+            if (width == 0 || columns(0, cursor()) < width) {
+                scroll = 0;
+                return;
+            }
+
+            size_t shown = 0;
+            scroll       = cursor();
+            while (scroll > 0) {
+                const size_t previous = previous_char(scroll);
+                shown += columns(previous, scroll);
+                if (shown > width / 2) break;
+                scroll = previous;
+            }
+        }
+
+        auto line_editor::redraw() -> void {
+            auto &out = utils::out();
+            out << '\r';
+            if (origin > 0) {
+                out << move_right(origin);
+            }
+            if (mode == echo::text) {
+                out << string_view(buffer.data() + scroll, gap_begin - scroll);
+            } else {
+                out.fill(columns(scroll, gap_begin), mask);
+            }
+            redraw_tail();
+        }
+
+        auto line_editor::redraw_tail() -> void {
+            auto &out         = utils::out();
+            const size_t room = (width == 0) ? string::npos : width - columns(scroll, cursor());
+            const string_view tail(buffer.data() + gap_end, buffer.size() - gap_end);
+
+            size_t shown;
+            const size_t bytes = fit_columns(tail, room, mode == echo::mask, shown);
+            if (mode == echo::text) {
+                out << tail.substr(0, bytes);
+            } else {
+                out.fill(shown, mask);
+            }
+            if (!hint.empty() && bytes == tail.size()) {// The hint follows the end of the answer
+                size_t hint_shown;
+                const size_t hint_bytes = fit_columns(hint, room - shown, false, hint_shown);
+                out << active_theme.hint << string_view(hint).substr(0, hint_bytes) << color::reset;
+                shown += hint_shown;
+            }
+            out << clear_line<EOL>();
+            if (shown > 0) {
+                out << move_left(shown);
+            }
+        }
+
+        // Delimiters of `format`, indexed by byte
+        static auto delimiter_table(const list_format &format) -> array<bool, 256> {
+            array<bool, 256> table{};
+            for (char c: format.delimiters) {
+                table[(unsigned char) c] = true;
+            }
+            return table;
+        }
+
+        // Call `item(begin, end, quoted)` for each item of `text` from the offset `from`, which begins an item.
+        // The last item is skipped when empty, as nothing follows its delimiter
+        template<typename F>
+        static auto scan_items(string_view text, size_t from, const array<bool, 256> &delimiters, char quote, F item) -> void {
+            size_t begin = from;
+            bool quoting = false;
+            bool quoted  = false;
+            for (size_t i = from; i < text.size(); i++) {
+                const char c = text[i];
+                if (quote != 0 && c == quote) {
+                    quoting = !quoting;
+                    quoted  = true;
+                } else if (!quoting && delimiters[(unsigned char) c]) {
+                    item(begin, i, quoted);
+                    begin  = i + 1;
+                    quoted = false;
+                }
+            }
+            if (begin < text.size()) {
+                item(begin, text.size(), quoted);
+            }
+        }
+
+        // Text of an item without its surrounding spaces and its quotes, a doubled quote between quotes is kept once
+        static auto unquote(string_view raw, bool quoted, char quote) -> string {
+            const size_t first = raw.find_first_not_of(' ');
+            if (first == string_view::npos) return "";
+            raw = raw.substr(first, raw.find_last_not_of(' ') - first + 1);
+            if (!quoted) return string(raw);
+
+            string result;
+            result.reserve(raw.size());
+            bool quoting = false;
+            for (size_t i = 0; i < raw.size(); i++) {
+                if (raw[i] != quote) {
+                    result += raw[i];
+                } else if (quoting && i + 1 < raw.size() && raw[i + 1] == quote) {
+                    result += quote;
+                    i++;
+                } else {
+                    quoting = !quoting;
+                }
+            }
+            return result;
+        }
+
+        auto tokenize(string_view text, const list_format &format) -> vector<string> {
+            const auto delimiters = delimiter_table(format);
+            size_t count          = 0;
+            scan_items(text, 0, delimiters, format.quote, [&count](size_t, size_t, bool) { count++; });
+
+            vector<string> items;
+            items.reserve(count);
+            scan_items(text, 0, delimiters, format.quote, [&](size_t begin, size_t end, bool quoted) {
+                items.push_back(unquote(text.substr(begin, end - begin), quoted, format.quote));
+            });
+            return items;
+        }
+
+        list_tokenizer::list_tokenizer(list_format format) : format(move(format)), delimiters(delimiter_table(this->format)) {}
+
+        auto list_tokenizer::update(const line_editor &answer, size_t from) -> void {
+            // Items before the edit point are unchanged, the one holding it begins after an unchanged delimiter
+            auto kept     = upper_bound(spans.begin(), spans.end(), from, [](size_t from, const span &item) {
+                return from < item.begin;
+            });
+            if (kept != spans.begin()) kept--;
+            const size_t begin = (kept == spans.end()) ? 0 : kept->begin;
+            spans.erase(kept, spans.end());
+
+            text.resize(begin);
+            answer.append_to(text, begin);
+            scan_items(text, begin, delimiters, format.quote, [this](size_t begin, size_t end, bool quoted) {
+                spans.push_back({begin, end, quoted});
+            });
+        }
+
+        auto list_tokenizer::size() const -> size_t {
+            return spans.size();
+        }
+
+        auto list_tokenizer::item(size_t i) const -> string {
+            const auto &item = spans[i];
+            return unquote(string_view(text).substr(item.begin, item.end - item.begin), item.quoted, format.quote);
+        }
+
+        auto list_tokenizer::items() const -> vector<string> {
+            vector<string> result;
+            result.reserve(spans.size());
+            for (size_t i = 0; i < spans.size(); i++) {
+                result.push_back(item(i));
+            }
+            return result;
+        }
+
+        // Line under the answer of list with its items, cut to the width of the terminal
+        auto draw_list_preview(const list_tokenizer &tokens) -> void {
+            auto &out = utils::out();
+            out << save_cursor() << move_down<1>() << move_left<1000>() << clear_line<EOL>();
+            if (tokens.size() > 0) {
+                const unsigned int columns = terminal_size().ws_col;
+                const size_t width         = (columns > 0) ? columns - 1 : 79;
+                const string count         = to_string(tokens.size()) + (tokens.size() == 1 ? " item " : " items ");
+                out << active_theme.hint << count << active_theme.input_symbol << color::reset;
+                size_t used = display_width(count) + display_width(active_theme.input_symbol);
+                for (size_t i = 0; i < tokens.size(); i++) {
+                    const string item  = tokens.item(i);
+                    const size_t shown = display_width(item) + (i + 1 < tokens.size() ? 2 : 0);
+                    if (used + shown > width) {
+                        out << active_theme.hint << "…" << color::reset;
+                        break;
+                    }
+                    out << active_theme.answer << item << color::reset;
+                    if (i + 1 < tokens.size()) {
+                        out << ", ";
+                    }
+                    used += shown;
+                }
+            }
+            out << restore_cursor();
+        }
+
+        auto lfill(const string &src, const size_t width, const char fill = ' ') -> string {
+            const size_t length = display_width(src);
+            if (length >= width) {
+                return src;
+            }
+
+            return string(width - length, fill) + src;
+        }
+
+        auto max_size(const vector<string> &strs) -> unsigned int {
+            unsigned int max = 0;
+            for (const auto &str: strs)
+                max = std::max(max, (unsigned int) display_width(str));
+
+            return max;
+        }
+
+        // Retained renderer for multi-line widgets: keep the rows displayed on the terminal
+        // and only rewrite the ones that changed since the previous frame.
+        // Between two frames the cursor is parked at the beginning of the line following the last row.
+        class virtual_screen {
+        public:
+            // Start a new frame of `height` rows, rows keep the content of the previous frame
+            auto begin_frame(unsigned int height) -> void {
+                next.resize(height);
+            }
+
+            // Buffer of the row `index` of the frame being built
+            auto row(unsigned int index) -> string & {
+                return next[index];
+            }
+
+            // Write the rows that differ from the displayed frame
+            auto render() -> void {
+                auto &out = utils::out();
+                const auto height = (unsigned int) next.size();
+                unsigned int cursor = displayed.size();
+                for (unsigned int i = 0; i < height && i < displayed.size(); i++) {
+                    if (!stale && next[i] == displayed[i]) {
+                        continue;
+                    }
+
+                    if (cursor > i) {
+                        out << move_up(cursor - i);
+                    } else if (cursor < i) {
+                        out << move_down(i - cursor);
+                    }
+                    out << '\r' << clear_line<LINE>() << next[i];
+                    displayed[i] = next[i];
+                    cursor       = i;
+                }
+
+                if (height < displayed.size()) {// Erase rows which are no longer part of the frame
+                    for (auto i = (unsigned int) displayed.size() - 1; i >= height; i--) {
+                        if (cursor > i) {
+                            out << move_up(cursor - i);
+                        } else if (cursor < i) {
+                            out << move_down(i - cursor);
+                        }
+                        out << '\r' << clear_line<LINE>();
+                        cursor = i;
+                        if (i == 0) break;
+                    }
+                    displayed.resize(height);
+                }
+                if (cursor < displayed.size()) {
+                    out << move_down(displayed.size() - cursor);
+                }
+                out << '\r';
+
+                for (auto i = (unsigned int) displayed.size(); i < height; i++) {// New rows
+                    out << clear_line<LINE>() << next[i] << '\n';
+                    displayed.push_back(next[i]);
+                }
+                stale = false;
+            }
+
+            // Number of rows currently displayed
+            auto height() const -> unsigned int {
+                return displayed.size();
+            }
+
+            // Rewrite every row on the next render, e.g. when the terminal may have reflowed them
+            auto invalidate() -> void {
+                stale = true;
+            }
+
+        private:
+            vector<string> displayed;
+            vector<string> next;
+            bool stale = false;
+        };
+
+
+        auto viewport::scroll_to(unsigned int index) -> void {
+            if (index < top) {
+                top = index;
+            } else if (index >= top + height) {
+                top = index - height + 1;
+            }
+        }
+
+        auto fit_viewport(size_t count, unsigned int rows, unsigned int reserved) -> viewport {
+            if (rows <= 2 + reserved) {// Unknown size, e.g. not a terminal
+                return {0, (unsigned int) count};
+            }
+
+            return {0, (unsigned int) min(count, (size_t) rows - 2 - reserved)};// Keep room for the question and the cursor
+        }
+
+        auto list_viewport(size_t count, unsigned int reserved) -> viewport {
+            return fit_viewport(count, terminal_size().ws_row, reserved);
+        }
+
+        auto refit(viewport &view, size_t count, unsigned int rows, unsigned int reserved) -> void {
+            view.height = fit_viewport(count, rows, reserved).height;
+            view.top    = min(view.top, (unsigned int) count - view.height);
+        }
+
+        auto jump(key code, unsigned int row, size_t count, unsigned int page) -> unsigned int {
+            page = max(page, 1U);
+            switch (code) {
+                case key::home:
+                    return 0;
+                case key::end:
+                    return count - 1;
+                case key::page_up:
+                    return (row > page) ? row - page : 0;
+                case key::page_down:
+                    return (unsigned int) min((size_t) row + page, count - 1);
+                default:
+                    return row;
+            }
+        }
+
+        auto slider_bar(unsigned int width, int marker) -> void {
+            auto &out = utils::out();
+            const theme &theme = active_theme;
+            out << "  " << theme.slider << "<" << (color::reset | theme.bar);
+            if (marker < 0) {
+                out.fill(width + 1, '-');
+            } else {
+                out.fill(marker, '-');
+                out << (color::reset | theme.slider) << "#" << (color::reset | theme.bar);
+                out.fill(width - marker, '-');
+            }
+            out << (color::reset | theme.slider) << ">" << color::reset;
+        }
+
+        auto move_slider_marker(int from, int to) -> void {
+            auto &out = utils::out();
+            if (from >= 0) {
+                out << move_right(3 + from) << active_theme.bar << "-" << color::reset << '\r';
+            }
+            if (to >= 0) {
+                out << move_right(3 + to) << active_theme.slider << "#" << color::reset << '\r';
+            }
+        }
+
+        auto select_row(string &row, const string &choice, bool highlighted) -> void {
+            row.clear();
+            if (highlighted) {
+                row += active_theme.pointer;
+                row += active_theme.pointer_symbol;
+                row += color::reset | active_theme.highlight;
+                row += choice;
+                row += color::reset;
+            } else {
+                row.append(display_width(active_theme.pointer_symbol), ' ');
+                row += choice;
+            }
+        }
+
+        // Choices sorted once, so that the choices beginning with a given prefix are a contiguous range
+        class prefix_index {
+        public:
+            // Range [first, last) of ranks in the sorted choices
+            typedef pair<size_t, size_t> range;
+
+            explicit prefix_index(const vector<string> &choices) : choices(choices), sorted(choices.size()) {
+                for (unsigned int i = 0; i < sorted.size(); i++) {
+                    sorted[i] = i;
+                }
+                stable_sort(sorted.begin(), sorted.end(), [&choices](unsigned int a, unsigned int b) {
+                    return choices[a] < choices[b];
+                });
+            }
+
+            // Index the choices added to the list since `from`
+            auto append(size_t from) -> void {
+                const size_t middle = sorted.size();
+                for (size_t i = from; i < choices.size(); i++) {
+                    sorted.push_back(i);
+                }
+                auto by_choice = [this](unsigned int a, unsigned int b) {
+                    return choices[a] < choices[b];
+                };
+                stable_sort(sorted.begin() + middle, sorted.end(), by_choice);
+                inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end(), by_choice);
+            }
+
+            // Choices of `within` having `c` at `position`, where `within` is the range of a prefix of length `position`.
+            // Only the character at `position` has to be compared, the choices of the range share the previous ones
+            auto narrow(range within, size_t position, char c) const -> range {
+                auto char_at = [this, position](unsigned int item) -> int {
+                    const string &choice = choices[item];
+                    return position < choice.length() ? (unsigned char) choice[position] : -1;
+                };
+                auto begin = sorted.begin() + within.first;
+                auto end   = sorted.begin() + within.second;
+                auto first = lower_bound(begin, end, (unsigned char) c, [&char_at](unsigned int item, int value) {
+                    return char_at(item) < value;
+                });
+                auto last  = upper_bound(first, end, (unsigned char) c, [&char_at](int value, unsigned int item) {
+                    return value < char_at(item);
+                });
+
+                return {first - sorted.begin(), last - sorted.begin()};
+            }
+
+            auto size() const -> size_t {
+                return sorted.size();
+            }
+
+            // Choice of rank `rank` in the sorted choices
+            auto operator[](size_t rank) const -> const string & {
+                return choices[sorted[rank]];
+            }
+
+        private:
+            const vector<string> &choices;
+            vector<unsigned int> sorted;
+        };
+
+        // Ranges of each prefix of the answer: typing narrows the range of the previous prefix
+        // and erasing goes back to the range already computed for the shorter prefix
+        class prefix_search {
+        public:
+            explicit prefix_search(const prefix_index &index) : index(index), ranges({{0, index.size()}}) {}
+
+            // Forget the ranges, e.g. after choices were added to the index
+            auto reset() -> void {
+                query.clear();
+                ranges = {{0, index.size()}};
+            }
+
+            auto update(string_view answer) -> prefix_index::range {
+                size_t common = 0;
+                while (common < query.length() && common < answer.length() && query[common] == answer[common]) {
+                    common++;
+                }
+                query.resize(common);
+                ranges.resize(common + 1);
+
+                for (size_t i = common; i < answer.length(); i++) {
+                    ranges.push_back(index.narrow(ranges.back(), i, answer[i]));
+                    query.push_back(answer[i]);
+                }
+
+                return ranges.back();
+            }
+
+        private:
+            const prefix_index &index;
+            string query;
+            vector<prefix_index::range> ranges;// ranges[i] is the range of query.substr(0, i)
+        };
+
+        struct fuzzy_match {
+            int score;
+            unsigned int length;
+            unsigned int index;
+        };
+
+        // Best score first, then the shortest choice, then the first given
+        auto better(const fuzzy_match &a, const fuzzy_match &b) -> bool {
+            if (a.score != b.score) return a.score > b.score;
+            if (a.length != b.length) return a.length < b.length;
+            return a.index < b.index;
+        }
+
+        auto fold(unsigned char c) -> unsigned char {
+            return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+        }
+
+        // Characters of a string folded to 64 bits: one bit per letter (case insensitive) and digit,
+        // the other bytes share the remaining bits
+        auto char_bit(unsigned char c) -> uint64_t {
+            c = fold(c);
+            if (c >= 'a' && c <= 'z') return 1ULL << (c - 'a');
+            if (c >= '0' && c <= '9') return 1ULL << (26 + c - '0');
+            return 1ULL << (36 + c % 28);
+        }
+
+        auto char_mask(string_view str) -> uint64_t {
+            uint64_t mask = 0;
+            for (unsigned char c: str) mask |= char_bit(c);
+            return mask;
+        }
+
+        // Append to `result` the index of each mask containing all the bits of `query`
+        auto prefilter(const uint64_t *masks, size_t count, uint64_t query, vector<unsigned int> &result) -> void {
+            size_t i = 0;
+#if defined(__AVX2__)
+            const __m256i wanted = _mm256_set1_epi64x((long long) query);
+            const __m256i zero   = _mm256_setzero_si256();
+            for (; i + 4 <= count; i += 4) {
+                __m256i missing = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *) (masks + i)), wanted);
+                int hits        = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(missing, zero)));
+                while (hits != 0) {
+                    result.push_back(i + __builtin_ctz(hits));
+                    hits &= hits - 1;
+                }
+            }
+#elif defined(__SSE2__)
+            const __m128i wanted = _mm_set1_epi64x((long long) query);
+            const __m128i zero   = _mm_setzero_si128();
+            for (; i + 2 <= count; i += 2) {
+                __m128i missing = _mm_andnot_si128(_mm_loadu_si128((const __m128i *) (masks + i)), wanted);
+                int bytes       = _mm_movemask_epi8(_mm_cmpeq_epi32(missing, zero));
+                if ((bytes & 0x00FF) == 0x00FF) result.push_back(i);
+                if ((bytes & 0xFF00) == 0xFF00) result.push_back(i + 1);
+            }
+#endif
+            for (; i < count; i++) {
+                if ((masks[i] & query) == query) result.push_back(i);
+            }
+        }
+
+        auto is_separator(unsigned char c) -> bool {
+            return c == ' ' || c == '/' || c == '\\' || c == '_' || c == '-' || c == '.' || c == ':' || c == ',';
+        }
+
+        // Bonus for a match at `position`: beginning of the choice, of a word or of a camelCase hump
+        auto position_bonus(string_view choice, size_t position) -> int {
+            if (position == 0) return 10;
+            const unsigned char previous = choice[position - 1];
+            if (is_separator(previous)) return 8;
+            if (islower(previous) && isupper((unsigned char) choice[position])) return 7;
+            return 0;
+        }
+
+        // Offset of the first byte of `choice` from `from` equal to `c` ignoring the case, or the size of `choice`
+        auto find_folded(string_view choice, size_t from, unsigned char c) -> size_t {
+            const unsigned char lower = fold(c);
+            const unsigned char upper = (lower >= 'a' && lower <= 'z') ? lower - ('a' - 'A') : lower;
+            size_t i                  = from;
+#if defined(__SSE2__)
+            const __m128i lowers = _mm_set1_epi8((char) lower);
+            const __m128i uppers = _mm_set1_epi8((char) upper);
+            for (; i + 16 <= choice.size(); i += 16) {
+                const __m128i bytes = _mm_loadu_si128((const __m128i *) (choice.data() + i));
+                const int hits      = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, lowers), _mm_cmpeq_epi8(bytes, uppers)));
+                if (hits != 0) return i + __builtin_ctz(hits);
+            }
+#endif
+            for (; i < choice.size(); i++) {
+                if (fold(choice[i]) == lower) return i;
+            }
+            return choice.size();
+        }
+
+        // Score of `query` as a case insensitive subsequence of `choice`, or -1 if it does not match.
+        // The match is the shortest window ending at the first complete occurrence, like fzf v1.
+        // The forward search, which reads the most of the choice, compares 16 bytes at a time; the window is scored
+        // byte by byte, each bonus depends on the previous match
+        auto fuzzy_score(string_view choice, string_view query) -> int {
+            if (query.empty()) return 0;
+
+            size_t end = 0;
+            for (unsigned char c: query) {
+                end = find_folded(choice, end, c);
+                if (end == choice.size()) return -1;
+                end++;
+            }
+            size_t q;
+
+            size_t start = end;
+            for (q = query.length(); q > 0; start--) {
+                if (fold(choice[start - 1]) == fold(query[q - 1])) q--;
+            }
+
+            int score         = 0;
+            int chunk_bonus   = 0;// Bonus of the first character of the current run of consecutive matches
+            bool previous_hit = false;
+            for (size_t i = start; i < end; i++) {
+                if (q < query.length() && fold(choice[i]) == fold(query[q])) {
+                    int bonus = position_bonus(choice, i);
+                    if (previous_hit) {
+                        bonus = max(bonus, max(chunk_bonus, 4));
+                    } else {
+                        chunk_bonus = bonus;
+                    }
+                    score += 16 + (q == 0 ? 2 * bonus : bonus);
+                    previous_hit = true;
+                    q++;
+                } else {
+                    score -= previous_hit ? 3 : 1;
+                    previous_hit = false;
+                }
+            }
+
+            return score;
+        }
+
+        // Keep `match` in the heap of the `limit` best matches, which has the worst of them on top
+        auto keep_best(vector<fuzzy_match> &heap, const fuzzy_match &match, unsigned int limit) -> void {
+            if (heap.size() < limit) {
+                heap.push_back(match);
+                push_heap(heap.begin(), heap.end(), better);
+            } else if (limit > 0 && better(match, heap.front())) {
+                pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = match;
+                push_heap(heap.begin(), heap.end(), better);
+            }
+        }
+
+        // Threads started once and reused by every prompt
+        class worker_pool {
+        public:
+            explicit worker_pool(unsigned int size) {
+                for (unsigned int i = 1; i < size; i++) {
+                    threads.emplace_back([this, i]() { work(i); });
+                }
+            }
+
+            ~worker_pool() {
+                {
+                    lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for (auto &thread: threads) {
+                    thread.join();
+                }
+            }
+
+            // Number of threads running a task, the calling one included
+            auto size() const -> unsigned int {
+                return threads.size() + 1;
+            }
+
+            // Run `task(worker)` on each thread of the pool and on the calling one as worker 0,
+            // returns once every thread returned
+            auto run(const function<void(unsigned int)> &task) -> void {
+                {
+                    lock_guard<std::mutex> lock(mutex);
+                    current = &task;
+                    running = threads.size();
+                    generation++;
+                }
+                wake.notify_all();
+                task(0);
+
+                unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this]() { return running == 0; });
+                current = nullptr;
+            }
+
+        private:
+            auto work(unsigned int worker) -> void {
+                unsigned int seen = 0;
+                while (true) {
+                    const function<void(unsigned int)> *task;
+                    {
+                        unique_lock<std::mutex> lock(mutex);
+                        wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+                        if (stopping) return;
+                        seen = generation;
+                        task = current;
+                    }
+
+                    (*task)(worker);
+
+                    lock_guard<std::mutex> lock(mutex);
+                    if (--running == 0) done.notify_one();
+                }
+            }
+
+            vector<thread> threads;
+            std::mutex mutex;
+            condition_variable wake;
+            condition_variable done;
+            const function<void(unsigned int)> *current = nullptr;
+            unsigned int generation                     = 0;
+            unsigned int running                        = 0;
+            bool stopping                               = false;
+        };
+
+        static unique_ptr<worker_pool> match_workers;
+
+        // Fuzzy matcher over the choices. The characters of each choice are folded once to a mask, so that a SIMD scan
+        // of the masks discards most of the choices before scoring. While the query grows, only the choices
+        // which matched the previous query are tried again.
+        // Scoring is split in chunks, shared with the match workers for large lists
+        class fuzzy_index {
+        public:
+            static constexpr size_t chunk_size         = 8192;
+            static constexpr size_t parallel_threshold = 4 * chunk_size;
+
+            explicit fuzzy_index(const vector<string> &choices) : choices(choices), masks(choices.size()) {
+                for (size_t i = 0; i < choices.size(); i++) {
+                    masks[i] = char_mask(choices[i]);
+                }
+            }
+
+            // Fold the choices added to the list since `from`
+            auto append(size_t from) -> void {
+                masks.resize(choices.size());
+                for (size_t i = from; i < choices.size(); i++) {
+                    masks[i] = char_mask(choices[i]);
+                }
+                last_query.clear();
+                candidates.clear();
+            }
+
+            // Best `limit` matches of `query` in `best`, best first. Between two chunks, `cancelled` tells whether
+            // the result is still wanted, if not the search stops and returns false leaving everything unchanged
+            auto search(string_view query, unsigned int limit, vector<fuzzy_match> &best, const function<bool()> &cancelled) -> bool {
+                if (query.empty()) {// Everything matches, keep the given order
+                    best.clear();
+                    for (unsigned int i = 0; i < choices.size() && i < limit; i++) {
+                        best.push_back({0, (unsigned int) choices[i].length(), i});
+                    }
+                    last_query.clear();
+                    candidates.clear();
+                    return true;
+                }
+
+                vector<unsigned int> filtered;
+                const bool narrowing = !last_query.empty() && query.substr(0, last_query.length()) == last_query;
+                if (!narrowing) {
+                    prefilter(masks.data(), masks.size(), char_mask(query), filtered);
+                }
+                const vector<unsigned int> &input = narrowing ? candidates : filtered;
+
+                const size_t chunks  = (input.size() + chunk_size - 1) / chunk_size;
+                worker_pool *workers = (match_workers && input.size() >= parallel_threshold) ? match_workers.get() : nullptr;
+                vector<vector<unsigned int>> kept(chunks);// Candidates still matching, per chunk to keep their order
+                vector<vector<fuzzy_match>> heaps(workers ? workers->size() : 1);
+                atomic<size_t> next_chunk(0);
+                atomic<bool> stop(false);
+
+                auto task = [&](unsigned int worker) {
+                    while (!stop) {
+                        const size_t chunk = next_chunk++;
+                        if (chunk >= chunks) break;
+
+                        const size_t end = min(input.size(), (chunk + 1) * chunk_size);
+                        for (size_t i = chunk * chunk_size; i < end; i++) {
+                            const unsigned int index = input[i];
+                            const int score          = fuzzy_score(choices[index], query);
+                            if (score < 0) continue;
+
+                            kept[chunk].push_back(index);
+                            keep_best(heaps[worker], {score, (unsigned int) choices[index].length(), index}, limit);
+                        }
+                        if (worker == 0 && cancelled && cancelled()) stop = true;
+                    }
+                };
+                if (workers) {
+                    workers->run(task);
+                } else {
+                    task(0);
+                }
+                if (stop) {
+                    return false;
+                }
+
+                best.clear();
+                for (const auto &heap: heaps) {
+                    best.insert(best.end(), heap.begin(), heap.end());
+                }
+                sort(best.begin(), best.end(), better);
+                if (best.size() > limit) best.resize(limit);
+
+                candidates.clear();
+                for (const auto &chunk: kept) {
+                    candidates.insert(candidates.end(), chunk.begin(), chunk.end());
+                }
+                last_query = query;
+                return true;
+            }
+
+        private:
+            const vector<string> &choices;
+            vector<uint64_t> masks;
+            string last_query;
+            vector<unsigned int> candidates;// Choices matching last_query
+        };
+
+        // Completions of the answer displayed by autocomplete, according to the match mode
+        class completer {
+        public:
+            completer(const vector<string> &choices, unsigned int limit, match_mode mode)
+                : choices(choices), limit(limit), mode(mode) {
+                if (mode == match_mode::fuzzy) {
+                    fuzzy = make_unique<fuzzy_index>(choices);
+                } else {
+                    index  = make_unique<prefix_index>(choices);
+                    search = make_unique<prefix_search>(*index);
+                }
+            }
+
+            // Index the choices added to the list since the last call
+            auto refresh() -> void {
+                stopwatch timer(&prompt_metrics::matching);
+                if (mode == match_mode::fuzzy) {
+                    fuzzy->append(indexed);
+                } else {
+                    index->append(indexed);
+                    search->reset();
+                }
+                indexed = choices.size();
+            }
+
+            // Find the completions of `answer`. When `cancellable`, a fuzzy search is abandoned as soon as another key
+            // is waiting, the previous completions are kept and false is returned
+            auto update(string_view answer, bool cancellable) -> bool {
+                stopwatch timer(&prompt_metrics::matching);
+                if (mode == match_mode::fuzzy) {
+                    return fuzzy->search(answer, limit, matches, cancellable ? input_pending : function<bool()>());
+                }
+
+                range = search->update(answer);
+                return true;
+            }
+
+            auto size() const -> unsigned int {
+                if (mode == match_mode::fuzzy) {
+                    return matches.size();
+                }
+                return min((size_t) limit, range.second - range.first);
+            }
+
+            auto operator[](unsigned int i) const -> const string & {
+                if (mode == match_mode::fuzzy) {
+                    return choices[matches[i].index];
+                }
+                return (*index)[range.first + i];
+            }
+
+        private:
+            const vector<string> &choices;
+            const unsigned int limit;
+            const match_mode mode;
+            size_t indexed = choices.size();
+            unique_ptr<prefix_index> index;
+            unique_ptr<prefix_search> search;
+            prefix_index::range range = {0, 0};
+            unique_ptr<fuzzy_index> fuzzy;
+            vector<fuzzy_match> matches;
+        };
+
+        auto loading_row(string &row) -> void {
+            row.clear();
+            row += active_theme.hint;
+            row += "  …";
+            row += color::reset;
+        }
+
+        auto draw_select(virtual_screen &screen,
+                         viewport &view,
+                         const vector<string> &choices,
+                         unsigned int choice,
+                         bool loading = false) -> void {
+            if (view.height > 0) {
+                view.scroll_to(choice);
+            }
+            screen.begin_frame(view.height + (loading ? 1 : 0));
+            for (unsigned int i = 0; i < view.height; i++) {
+                select_row(screen.row(i), choices[view.top + i], view.top + i == choice);
+            }
+            if (loading) {
+                loading_row(screen.row(view.height));
+            }
+            screen.render();
+        }
+
+        // Checked rows of a multi select, one bit per row so bulk operations
+        // touch a 64 bits word at a time
+        class selection {
+        public:
+            explicit selection(size_t size) : _size(size), _words((size + 63) / 64, 0) {}
+
+            auto size() const -> size_t { return _size; }
+
+            auto test(size_t i) const -> bool {
+                return (_words[i / 64] >> (i % 64)) & 1;
+            }
+
+            auto set(size_t i, bool value = true) -> void {
+                if (value) {
+                    _words[i / 64] |= uint64_t{1} << (i % 64);
+                } else {
+                    _words[i / 64] &= ~(uint64_t{1} << (i % 64));
+                }
+            }
+
+            auto set_all(bool value) -> void {
+                fill(_words.begin(), _words.end(), value ? ~uint64_t{0} : 0);
+                trim();
+            }
+
+            auto invert() -> void {
+                for (auto &word: _words) {
+                    word = ~word;
+                }
+                trim();
+            }
+
+            // Set or clear the rows between first and last, both included
+            auto set_range(size_t first, size_t last, bool value) -> void {
+                if (first > last) swap(first, last);
+                for (size_t word = first / 64; word <= last / 64; word++) {
+                    uint64_t mask = ~uint64_t{0};
+                    if (word == first / 64) mask &= ~uint64_t{0} << (first % 64);
+                    if (word == last / 64) mask &= ~uint64_t{0} >> (63 - last % 64);
+                    if (value) {
+                        _words[word] |= mask;
+                    } else {
+                        _words[word] &= ~mask;
+                    }
+                }
+            }
+
+            auto count() const -> size_t {
+                size_t total = 0;
+                for (auto word: _words) {
+                    total += __builtin_popcountll(word);
+                }
+                return total;
+            }
 
-    // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
-    // Utilities
+            auto all() const -> bool {
+                return count() == _size;
+            }
 
-    namespace color {
-        const string black   = "\033[30m";
-        const string red     = "\033[31m";
-        const string green   = "\033[32m";
-        const string yellow  = "\033[33m";
-        const string blue    = "\033[34m";
-        const string magenta = "\033[35m";
-        const string cyan    = "\033[36m";
-        const string white   = "\033[37m";
-        const string grey    = "\033[90m";
-
-        const string reset     = "\033[0m";
-        const string bold      = "\033[1m";
-        const string underline = "\033[4m";
-        const string blink     = "\033[5m";
-        const string inverse   = "\033[7m";
-    }// namespace color
+            // First checked row from i, size() when there is none
+            auto next(size_t i) const -> size_t {
+                if (i >= _size) return _size;
+                size_t word = i / 64;
+                uint64_t bits = _words[word] & (~uint64_t{0} << (i % 64));
+                while (bits == 0) {
+                    if (++word == _words.size()) return _size;
+                    bits = _words[word];
+                }
+                return word * 64 + __builtin_ctzll(bits);
+            }
 
-    namespace utils {
-        auto move_up(unsigned int n = 1) -> string {
-            return "\033[" + to_string(n) + "A";
+            // Checked choices, in the order of the list
+            auto pick(const vector<string> &choices) const -> vector<string> {
+                vector<string> items;
+                items.reserve(count());
+                for (size_t i = next(0); i < _size; i = next(i + 1)) {
+                    items.push_back(choices[i]);
+                }
+                return items;
+            }
+
+        private:
+            // Keep the bits past the last row cleared so count() stays exact
+            auto trim() -> void {
+                if (_size % 64 != 0) {
+                    _words.back() &= ~uint64_t{0} >> (64 - _size % 64);
+                }
+            }
+
+            size_t _size;
+            vector<uint64_t> _words;
+        };
+
+        auto multi_select_row(string &row, const string &choice, bool checked, bool highlighted) -> void {
+            row.clear();
+            row += checked ? active_theme.checked : active_theme.unchecked;
+            row += active_theme.check_symbol;
+            row += color::reset;
+            if (highlighted) {
+                row += active_theme.highlight;
+                row += choice;
+                row += color::reset;
+            } else {
+                row += choice;
+            }
         }
 
-        auto move_down(unsigned int n = 1) -> string {
-            return "\033[" + to_string(n) + "B";
+        auto draw_multi_select(virtual_screen &screen,
+                               viewport &view,
+                               const vector<string> &choices,
+                               const selection &checked,
+                               unsigned int selected) -> void {
+            view.scroll_to(selected);
+            screen.begin_frame(view.height);
+            for (unsigned int i = 0; i < view.height; i++) {
+                multi_select_row(screen.row(i), choices[view.top + i], checked.test(view.top + i), view.top + i == selected);
+            }
+            screen.render();
         }
 
-        auto move_left(unsigned int n = 1) -> string {
-            return "\033[" + to_string(n) + "D";
+        // Label of a field of form or auth, with the symbol telling whether it is filled
+        auto print_field(string_view label, bool filled, bool active) -> void {
+            const theme &theme = active_theme;
+            print_question(label,
+                           filled ? theme.success : theme.unchecked,
+                           filled ? theme.filled_symbol : theme.empty_symbol,
+                           active ? theme.active : style());
         }
 
-        auto move_right(unsigned int n = 1) -> string {
-            return "\033[" + to_string(n) + "C";
+        // Rewrite a line of a form, the cursor moves from the line `row` to the end of the answer of the line.
+        // `label` is already padded to the width of the labels
+        auto draw_form_line(unsigned int &row,
+                            unsigned int line,
+                            const string &label,
+                            const string &answer,
+                            bool active) -> void {
+            auto &out = utils::out();
+            out << move_left<1000>();
+            if (line < row) {
+                out << move_up(row - line);
+            } else if (line > row) {
+                out << move_down(line - row);
+            }
+            row = line;
+            print_field(label, !answer.empty(), active);
+            out << answer;
         }
+    }// namespace utils
 
-        typedef enum {
-            EOL  = 0,
-            BOL  = 1,
-            LINE = 2
-        } clear_mode;
+    // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+    // Choice source
 
-        auto clear_line(clear_mode mode) -> string {
-            return "\033[" + to_string(mode) + "K";
+    choice_source::choice_source() {
+        if (pipe(pipe_fds) != 0) {
+            throw system_error(errno, generic_category(), "enquirer: cannot create choice source pipe");
         }
+    }
 
-        auto hide_cursor() -> string {
-            return "\033[?25l";
-        }
+    choice_source::choice_source(const function<void(choice_source &)> &producer)
+        : choice_source() {
+        this->producer = thread([this, producer] {
+            producer(*this);
+            close();
+        });
+    }
 
-        auto show_cursor() -> string {
-            return "\033[?25h";
+    choice_source::~choice_source() {
+        cancel();
+        if (producer.joinable()) {
+            producer.join();
         }
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+    }
 
-        auto print_question(const string &question,
-                            const string &symbol = color::cyan + color::bold + "? ",
-                            const string &input  = color::grey + color::bold + "› ") -> void {
-            cout << clear_line(LINE);
-            cout << symbol
-                 << color::reset << question
-                 << " " << input
-                 << color::reset;
-        }
+    auto choice_source::push(string choice) -> bool {
+        if (cancelled()) return false;
 
-        auto print_answer(const string &question) -> void {
-            print_question(question, color::green + color::bold + "✔ ", color::grey + color::bold + "· ");
-        }
+        lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(choice));
+        signal();
+        return true;
+    }
 
-        auto enable_raw_mode() -> void {
-            struct termios term {};
-            tcgetattr(STDIN_FILENO, &term);
-            term.c_lflag &= ~(ECHO | ICANON);
-            tcsetattr(STDIN_FILENO, TCSAFLUSH, &term);
-        }
+    auto choice_source::close() -> void {
+        lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        signal();
+    }
 
-        auto disable_raw_mode() -> void {
-            struct termios term {};
-            tcgetattr(STDIN_FILENO, &term);
-            term.c_lflag |= (ECHO | ICANON);
-            tcsetattr(STDIN_FILENO, TCSAFLUSH, &term);
-        }
+    auto choice_source::cancel() -> void {
+        stopped.store(true, memory_order_relaxed);
+    }
 
-        auto ltrim(const string &str) -> string {
-            auto start = str.find_first_not_of(' ');
-            return (start == string::npos) ? "" : str.substr(start);
-        }
+    auto choice_source::cancelled() const -> bool {
+        return stopped.load(memory_order_relaxed);
+    }
 
-        auto rtrim(const string &str) -> string {
-            auto end = str.find_last_not_of(' ');
-            return (end == string::npos) ? "" : str.substr(0, end + 1);
+    auto choice_source::fetch(vector<string> &choices) -> bool {
+        lock_guard<std::mutex> lock(mutex);
+        if (signaled) {// Consume the wake-up byte
+            char byte;
+            while (read(pipe_fds[0], &byte, 1) < 0 && errno == EINTR) {}
+            signaled = false;
         }
+        if (pending.empty()) return false;
 
-        auto trim(const string &str) -> string {
-            return rtrim(ltrim(str));
+        if (choices.empty()) {
+            choices.swap(pending);
+        } else {
+            choices.insert(choices.end(), make_move_iterator(pending.begin()), make_move_iterator(pending.end()));
+            pending.clear();
         }
+        return true;
+    }
 
-        auto split(const string &str, const char delim) -> vector<string> {
-            vector<string> result;
-            stringstream ss(str);
-            string item;
-            while (getline(ss, item, delim)) {
-                result.push_back(trim(item));
-            }
+    auto choice_source::exhausted() -> bool {
+        lock_guard<std::mutex> lock(mutex);
+        return closed && pending.empty();
+    }
 
-            return result;
-        }
+    auto choice_source::fd() const -> int {
+        return pipe_fds[0];
+    }
 
-        auto filter(const vector<string> &src,
-                    const function<bool(const string &)> &predicate) -> vector<string> {
-            vector<string> result;
+    auto choice_source::signal() -> void {
+        if (signaled) return;// Only one byte is kept in the pipe
 
-            for (const auto &item: src) {
-                if (predicate(item)) {
-                    result.push_back(item);
-                }
-            }
+        const char byte = 1;
+        while (write(pipe_fds[1], &byte, 1) < 0 && errno == EINTR) {}
+        signaled = true;
+    }
 
-            return result;
-        }
+    // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
+    // Terminal session
 
-        auto begin_with(const string &src, const string &prefix) -> bool {
-            return src.find(prefix) == 0;
-        }
+    terminal_session::terminal_session()
+        : exceptions(uncaught_exceptions()) {
+        utils::enable_raw_mode();
+    }
 
-        auto lfill(const string &src, const size_t width, const char fill = ' ') -> string {
-            if (src.length() >= width) {
-                return src;
-            }
+    terminal_session::terminal_session(function<void(const prompt_metrics &)> observer)
+        : terminal_session() {
+        observed          = true;
+        previous_observer = std::move(metrics_observer);
+        metrics_observer  = std::move(observer);
+    }
 
-            return string(width - src.length(), fill) + src;
+    terminal_session::~terminal_session() {
+        if (observed) {
+            metrics_observer = std::move(previous_observer);
         }
-
-        auto max_size(const vector<string> &strs) -> unsigned int {
-            unsigned int max = 0;
-            for (const auto &str: strs)
-                if (str.length() > max)
-                    max = str.length();
-
-            return max;
+        if (uncaught_exceptions() > exceptions) {// Left in the middle of a prompt
+            auto &out = utils::out();
+            out << utils::show_cursor() << utils::disable_paste();
+            out.flush();
+            utils::reset_raw_mode();
+        } else {
+            utils::disable_raw_mode();
         }
-    }// namespace utils
+    }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Auth
 
-    auto auth(const string &id_prompt = "Username",
-              const string &pw_prompt = "Password",
-              char mask               = '*') -> pair<string, string> {
+    auto auth(const string &id_prompt,
+              const string &pw_prompt,
+              char mask) -> pair<string, string> {
+        utils::prompt_scope scope("auth", id_prompt);
+        if (utils::headless()) {
+            pair<string, string> answers = {utils::read_answer(id_prompt), ""};
+            answers.second               = utils::read_answer(pw_prompt);
+            if (answers.first.empty() || answers.second.empty()) {
+                throw answer_error(id_prompt + ", " + pw_prompt + ": both are required");
+            }
+            return answers;
+        }
+
+        auto &out = utils::out();
+
         // Print inputs
         vector<string> inputs        = {id_prompt, pw_prompt};
-        unsigned int width           = max(id_prompt.length(), pw_prompt.length());
+        unsigned int width           = utils::max_size(inputs);
+        const string id_label        = utils::lfill(id_prompt, width);
+        const string pw_label        = utils::lfill(pw_prompt, width);
+        const theme &theme           = utils::current_theme();
         unsigned int line            = 0;
         pair<string, string> answers = make_pair("", "");
-        utils::print_question(color::cyan + utils::lfill(id_prompt, width), color::grey + "⊙ ");
-        cout << endl;
-        utils::print_question(utils::lfill(pw_prompt, width), color::grey + "⊙ ");
-        cout << endl;
-        cout << utils::move_up(2) << utils::move_right(width + 5);
+        utils::print_field(id_label, false, true);
+        out << '\n';
+        utils::print_field(pw_label, false, false);
+        out << '\n';
+        out << utils::move_up<2>() << utils::move_right(utils::answer_column(theme.empty_symbol, width));
 
         // Get answers
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
+        out.flush();
+        while (utils::read_key(key)) {
             unsigned int previous = line;
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    if (!answers.first.empty() && !answers.second.empty()) {
-                        break;
-                    } else {
-                        line = answers.first.empty() ? 0 : 1;
-                    }
-                } else if (current == 127) {// Backspace
-                    if (line == 0 && !answers.first.empty())
-                        answers.first.pop_back();
-                    else if (line == 1 && !answers.second.empty())
-                        answers.second.pop_back();
-
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 65) {// Up
-                            line = (line == 0) ? 1 : 0;
-                        } else if (current == 66) {// Down
-                            line = (line == 1) ? 0 : 1;
-                        }
-                    }
+            if (key.code == utils::key::enter) {
+                if (!answers.first.empty() && !answers.second.empty()) {
+                    break;
+                } else {
+                    line = answers.first.empty() ? 0 : 1;
                 }
-            } else {// 'Normal' character
+            } else if (key.code == utils::key::backspace) {
+                utils::pop_char(line == 0 ? answers.first : answers.second);
+
+            } else if (key.code == utils::key::up) {
+                line = (line == 0) ? 1 : 0;
+            } else if (key.code == utils::key::down) {
+                line = (line == 1) ? 0 : 1;
+            } else if (key.code == utils::key::character) {// 'Normal' character
                 if (line == 0)
-                    answers.first += current;
+                    answers.first += key.character;
                 else
-                    answers.second += current;
+                    answers.second += key.character;
             }
 
             // Redraw inputs
-            cout << utils::move_left(1000) << (previous == 0 ? "" : utils::move_up());
-            cout << utils::clear_line(utils::EOL);
+            out << utils::move_left<1000>();
+            if (previous != 0) {
+                out << utils::move_up<1>();
+            }
+            out << utils::clear_line<utils::EOL>();
             if (line == 0) {
-                utils::print_question(color::cyan + utils::lfill(id_prompt, width), (answers.first.empty() ? color::grey + "⊙ " : color::green + "⦿ "));
-                cout << answers.first << endl;
-                utils::print_question(utils::lfill(pw_prompt, width), (answers.second.empty() ? color::grey + "⊙ " : color::green + "⦿ "));
-                cout << string(answers.second.length(), mask) << endl;
+                utils::print_field(id_label, !answers.first.empty(), true);
+                out << answers.first << '\n';
+                utils::print_field(pw_label, !answers.second.empty(), false);
+                out << string(utils::char_count(answers.second), mask) << '\n';
             } else {
-                utils::print_question(utils::lfill(id_prompt, width), (answers.first.empty() ? color::grey + "⊙ " : color::green + "⦿ "));
-                cout << answers.first << endl;
-                utils::print_question(color::cyan + utils::lfill(pw_prompt, width), (answers.second.empty() ? color::grey + "⊙ " : color::green + "⦿ "));
-                cout << string(answers.second.length(), mask) << endl;
+                utils::print_field(id_label, !answers.first.empty(), false);
+                out << answers.first << '\n';
+                utils::print_field(pw_label, !answers.second.empty(), true);
+                out << string(utils::char_count(answers.second), mask) << '\n';
             }
-            cout << utils::move_up(inputs.size() - line)
-                 << utils::move_right(width + 5 + (line == 0 ? answers.first.length() : answers.second.length()));
+            out << utils::move_up(inputs.size() - line)
+                << utils::move_right(line == 0 ? utils::answer_column(answers.first.empty() ? theme.empty_symbol : theme.filled_symbol, width) + utils::display_width(answers.first)
+                                               : utils::answer_column(answers.second.empty() ? theme.empty_symbol : theme.filled_symbol, width) + utils::char_count(answers.second));
+            out.flush();
         }
+        utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_left(1000) << (line == 0 ? "" : utils::move_up());
-        cout << utils::clear_line(utils::EOL);
-        utils::print_question(utils::lfill(id_prompt, width), (answers.first.empty() ? color::grey + "⊙ " : color::green + "⦿ "));
-        cout << answers.first << endl;
-        utils::print_question(utils::lfill(pw_prompt, width), (answers.second.empty() ? color::grey + "⊙ " : color::green + "⦿ "));
-        cout << string(answers.second.length(), mask) << endl;
+        out << utils::move_left<1000>();
+        if (line != 0) {
+            out << utils::move_up<1>();
+        }
+        out << utils::clear_line<utils::EOL>();
+        utils::print_field(id_label, !answers.first.empty(), false);
+        out << answers.first << '\n';
+        utils::print_field(pw_label, !answers.second.empty(), false);
+        out << string(utils::char_count(answers.second), mask) << '\n';
+        out.flush();
 
         return {answers.first, answers.second};
     }
 
     auto auth(const function<bool(const pair<string, string> &)> &predicate,
-              const string &id_prompt = "Username",
-              const string &pw_prompt = "Password",
-              char mask               = '*') -> bool {
+              const string &id_prompt,
+              const string &pw_prompt,
+              char mask) -> bool {
         return predicate(auth(id_prompt, pw_prompt, mask));
     }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Autocomplete
 
-    auto autocomplete(const string &question,
-                      const vector<string> &choices = {},
-                      unsigned int limit            = 10) -> string {
+    static auto streamed_autocomplete(const string &question,
+                                      const vector<string> &choices,
+                                      utils::choice_stream stream,
+                                      unsigned int limit,
+                                      match_mode mode) -> string {
+        utils::prompt_scope scope("autocomplete", question);
+        if (utils::headless()) {// Completions only help typing, any answer is valid
+            return utils::read_answer(question);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
-        vector<string> current_choices;
-        int choice = -1;
+        stream.fetch();
+        utils::completer completions(choices, limit, mode);
+        bool outdated      = false;// Completions were not updated since the answer changed
+        unsigned int shown = 0;
+        int choice         = -1;
+        const size_t start = utils::answer_column(utils::current_theme().question_symbol, utils::display_width(question));
 
         // Get answer
         string answer;
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
+        out.flush();
+        while (true) {
+            if (utils::wait_key(stream)) {
+                if (!utils::read_key(key)) break;
+
+                if (key.code == utils::key::enter) {
                     break;
-                } else if (current == 127) {// Backspace
-                    if (!answer.empty()) {
-                        answer.pop_back();
+                } else if (key.code == utils::key::backspace) {
+                    utils::pop_char(answer);
+                } else if (key.code == utils::key::tab) {
+                    if (outdated) {
+                        completions.update(answer, false);
+                        outdated = false;
                     }
-                } else if (current == 9 && choice != -1) {// Tab
-                    if (answer == current_choices[choice].substr(0, answer.length())) {
-                        answer = string(current_choices[choice]);
-                    }
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 65) {// Up
-                            choice = (choice == 0) ? (int) current_choices.size() - 1 : choice - 1;
-                        } else if (current == 66) {// Down
-                            choice = (choice == (int) min(limit, (unsigned int) current_choices.size()) - 1) ? 0 : choice + 1;
-                        }
+                    if (completions.size() > 0) {
+                        answer = completions[min(max(choice, 0), (int) completions.size() - 1)];
                     }
+                } else if (key.code == utils::key::up) {
+                    choice = (choice <= 0) ? (int) shown - 1 : choice - 1;
+                } else if (key.code == utils::key::down) {
+                    choice = (choice == (int) shown - 1) ? 0 : choice + 1;
+                } else if (key.code == utils::key::character) {// 'Normal' character
+                    answer += key.character;
                 }
-            } else {// 'Normal' character
-                answer += current;
+            }
+
+            // Index the choices which arrived in the meantime
+            if (stream.fetch()) {
+                completions.refresh();
+            }
+
+            // Find completions, skipped when another key is already waiting
+            outdated = !completions.update(answer, true);
+            if (outdated) {
+                continue;
             }
 
             // Erase previous choices
-            cout << utils::move_down(min(limit, (unsigned int) current_choices.size()) + 1)
-                 << utils::move_left(1000);
-            for (unsigned int i = 0; i < current_choices.size() && i < limit; i++) {
-                cout << utils::clear_line(utils::EOL)
-                     << utils::move_up();
+            out << utils::move_down(shown + 1)
+                << utils::move_left<1000>();
+            for (unsigned int i = 0; i < shown; i++) {
+                out << utils::clear_line<utils::EOL>()
+                    << utils::move_up<1>();
             }
-            cout << utils::move_up();
+            out << utils::move_up<1>();
             // Draw completion
-            current_choices = utils::filter(choices, [=](const string &item) {
-                return utils::begin_with(item, answer);
-            });
-            choice          = max(0, min(choice, (int) current_choices.size() - 1));
-            cout << utils::move_left(1000) << utils::clear_line(utils::LINE);
+            shown  = completions.size();
+            choice = max(0, min(choice, (int) shown - 1));
+            out << utils::move_left<1000>() << utils::clear_line<utils::LINE>();
             utils::print_question(question);
-            cout << answer;
-            if (!current_choices.empty()) {
-                cout << color::grey << current_choices[choice].substr(answer.length()) << color::reset;
+            out << answer;
+            if (shown > 0 && completions[choice].compare(0, answer.length(), answer) == 0) {
+                out << utils::current_theme().hint << string_view(completions[choice]).substr(answer.length()) << color::reset;
             }
-            cout << endl;
-            for (unsigned int i = 0; i < current_choices.size() && i < limit; i++) {
-                cout << utils::clear_line(utils::EOL);
+            out << '\n';
+            for (unsigned int i = 0; i < shown; i++) {
+                out << utils::clear_line<utils::EOL>();
                 if ((int) i == choice) {
-                    cout << color::cyan << color::underline << current_choices[i] << color::reset << endl;
+                    out << utils::current_theme().highlight << completions[i] << color::reset << '\n';
                 } else {
-                    cout << current_choices[i] << endl;
+                    out << completions[i] << '\n';
                 }
             }
-            cout << utils::move_up(min(limit, (unsigned int) current_choices.size()) + 1)
-                 << utils::move_left(1000) << utils::move_right(question.length() + answer.length() + 5);
+            out << utils::move_up(shown + 1)
+                << utils::move_left<1000>() << utils::move_right(start + utils::display_width(answer));
+            out.flush();
         }
         utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_down(min(limit, (unsigned int) current_choices.size()) + 1)
-             << utils::move_left(1000);
-        for (unsigned int i = 0; i < current_choices.size() && i < limit; i++) {
-            cout << utils::clear_line(utils::EOL)
-                 << utils::move_up();
-        }
-        cout << utils::move_up()
-             << utils::move_left(1000) << utils::clear_line(utils::LINE);
+        out << utils::move_down(shown + 1)
+            << utils::move_left<1000>();
+        for (unsigned int i = 0; i < shown; i++) {
+            out << utils::clear_line<utils::EOL>()
+                << utils::move_up<1>();
+        }
+        out << utils::move_up<1>()
+            << utils::move_left<1000>() << utils::clear_line<utils::LINE>();
         utils::print_answer(question);
-        cout << color::cyan << answer << color::reset << endl;
+        out << utils::current_theme().answer << answer << color::reset << '\n';
+        out.flush();
 
         return answer;
     }
 
+    auto autocomplete(const string &question,
+                      const vector<string> &choices,
+                      unsigned int limit,
+                      match_mode mode) -> string {
+        return streamed_autocomplete(question, choices, {}, limit, mode);
+    }
+
+    auto autocomplete(const string &question,
+                      choice_source &source,
+                      unsigned int limit,
+                      match_mode mode) -> string {
+        vector<string> choices;
+        return streamed_autocomplete(question, choices, {&source, &choices}, limit, mode);
+    }
+
+    auto set_match_threads(unsigned int threads) -> void {
+        if (threads == 0) {
+            threads = max(1U, thread::hardware_concurrency());
+        }
+
+        utils::match_workers.reset();
+        if (threads > 1) {
+            utils::match_workers = make_unique<utils::worker_pool>(threads);
+        }
+    }
+
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Confirm
 
     auto confirm(const string &question,
-                 bool default_value = false) -> bool {
+                 bool default_value) -> bool {
+        utils::prompt_scope scope("confirm", question);
+        if (utils::headless()) {
+            string answer = utils::read_answer(question);
+            return answer.empty() ? default_value : utils::parse_yes_no(question, answer);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
         // Print choices
         bool confirmed = default_value;
-        cout << (confirmed ? "Yes" : "No");
+        out << (confirmed ? "Yes" : "No");
 
         // Get answer
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        cout << utils::hide_cursor();
-        while (cin.get(current)) {
+        out << utils::hide_cursor();
+        out.flush();
+        while (utils::read_key(key)) {
             bool previous = confirmed;
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    break;
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 68) {// Left
-                            confirmed = true;
-                        } else if (current == 67) {// Right
-                            confirmed = false;
-                        }
-                    }
-                }
+            if (key.code == utils::key::enter) {
+                break;
+            } else if (key.code == utils::key::left) {
+                confirmed = true;
+            } else if (key.code == utils::key::right) {
+                confirmed = false;
             }
 
             // Redraw choices
-            cout << utils::move_left(previous ? 3 : 2)
-                 << utils::clear_line(utils::EOL)
-                 << (confirmed ? "Yes" : "No");
+            out << utils::move_left(previous ? 3 : 2)
+                << utils::clear_line<utils::EOL>()
+                << (confirmed ? "Yes" : "No");
+            out.flush();
         }
-        cout << utils::show_cursor();
+        out << utils::show_cursor();
         utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_left(1000);
+        out << utils::move_left<1000>();
         utils::print_answer(question);
-        cout << (confirmed ? color::green : color::red) << (confirmed ? "Yes" : "No") << color::reset << endl;
+        out << (confirmed ? utils::current_theme().success : utils::current_theme().failure) << (confirmed ? "Yes" : "No") << color::reset << '\n';
+        out.flush();
 
         return confirmed;
     }
@@ -413,253 +2536,269 @@ namespace enquirer {
 
     auto form(const string &question,
               const vector<string> &inputs) -> map<string, string> {
+        utils::prompt_scope scope("form", question);
+        auto &out = utils::out();
+
         if (inputs.empty()) {
             return {};
         }
 
+        if (utils::headless()) {// One line per input, in order
+            map<string, string> answers;
+            for (const auto &input: inputs) {
+                answers[input] = utils::read_answer(input);
+                if (answers[input].empty()) {
+                    throw answer_error(question + ": " + input + " is required");
+                }
+            }
+            return answers;
+        }
+
         // Print question
         utils::print_question(question);
-        cout << endl;
+        out << '\n';
 
         // Print inputs
         unsigned int width = utils::max_size(inputs);
         unsigned int line  = 0;
-        map<string, string> answers;
+        unsigned int row   = 0;// Line of the cursor
+        vector<string> labels;  // Padded once, the widths are not measured again on each key
+        labels.reserve(inputs.size());
+        for (const auto &input: inputs) {
+            labels.push_back(utils::lfill(input, width));
+        }
+        vector<string> answers(inputs.size());// Indexed as inputs
         for (unsigned int i = 0; i < inputs.size(); i++) {
-            answers[inputs[i]] = "";
-            if (i == line) {
-                utils::print_question(color::cyan + utils::lfill(inputs[i], width), color::grey + "⊙ ");
-            } else {
-                utils::print_question(utils::lfill(inputs[i], width), color::grey + "⊙ ");
-            }
-            cout << endl;
+            utils::print_field(labels[i], false, i == line);
+            out << '\n';
         }
-        cout << utils::move_up(inputs.size()) << utils::move_right(width + 5);
+        out << utils::move_up(inputs.size()) << utils::move_right(utils::answer_column(utils::current_theme().empty_symbol, width));
 
         // Get answers
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
+        out << utils::enable_paste();
+        out.flush();
+        while (utils::read_key(key)) {
             unsigned int previous = line;
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    if (all_of(answers.begin(), answers.end(),
-                               [](const pair<string, string> &item) {
-                                   return !item.second.empty();
-                               })) {
-                        break;
-                    } else {
-                        line = distance(answers.begin(),
-                                        find_if(answers.begin(), answers.end(),
-                                                [](const pair<string, string> &item) {
-                                                    return item.second.empty();
-                                                }));
-                    }
-                } else if (current == 127) {// Backspace
-                    if (!answers[inputs[line]].empty()) {
-                        answers[inputs[line]].pop_back();
-                    }
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 65) {// Up
-                            line = (line == 0) ? inputs.size() - 1 : line - 1;
-                        } else if (current == 66) {// Down
-                            line = (line == inputs.size() - 1) ? 0 : line + 1;
-                        }
-                    }
+            if (key.code == utils::key::enter) {
+                auto empty = find_if(answers.begin(), answers.end(),
+                                     [](const string &answer) {
+                                         return answer.empty();
+                                     });
+                if (empty == answers.end()) {
+                    break;
                 }
-            } else {// 'Normal' character
-                answers[inputs[line]] += current;
+                line = distance(answers.begin(), empty);
+            } else if (key.code == utils::key::backspace) {
+                if (!answers[line].empty()) {
+                    utils::pop_char(answers[line]);
+                }
+            } else if (key.code == utils::key::up) {
+                line = (line == 0) ? inputs.size() - 1 : line - 1;
+            } else if (key.code == utils::key::down) {
+                line = (line == inputs.size() - 1) ? 0 : line + 1;
+            } else if (key.code == utils::key::character) {// 'Normal' character
+                answers[line] += key.character;
+            } else if (key.code == utils::key::paste) {
+                utils::append_pasted(answers[line], key.text);
             }
 
-            // Redraw inputs
-            cout << utils::move_left(1000) << (previous == 0 ? "" : utils::move_up(previous));
-            for (unsigned int i = 0; i < inputs.size(); i++) {
-                cout << utils::clear_line(utils::EOL);
-                string indicator = (answers[inputs[i]].empty() ? color::grey + "⊙ " : color::green + "⦿ ");
-                if (i == line) {
-                    utils::print_question(color::cyan + utils::lfill(inputs[i], width), indicator);
-                } else {
-                    utils::print_question(utils::lfill(inputs[i], width), indicator);
-                }
-                cout << answers[inputs[i]] << endl;
+            // Redraw the edited line, or the lines losing and gaining the focus
+            if (line != previous) {
+                utils::draw_form_line(row, previous, labels[previous], answers[previous], false);
             }
-            cout << utils::move_up(inputs.size() - line)
-                 << utils::move_right(width + 5 + answers[inputs[line]].length());
+            utils::draw_form_line(row, line, labels[line], answers[line], true);
+            out.flush();
         }
 
+        out << utils::disable_paste();
+        utils::disable_raw_mode();
+
         // Print resume
-        cout << utils::move_left(1000) << (line == 0 ? "" : utils::move_up(line))
-             << utils::move_up()
-             << utils::clear_line(utils::EOL);
+        out << utils::move_left<1000>();
+        if (row != 0) {
+            out << utils::move_up(row);
+        }
+        out << utils::move_up<1>()
+            << utils::clear_line<utils::EOL>();
         utils::print_answer(question);
-        cout << endl;
-        for (const auto &input: inputs) {
-            cout << utils::clear_line(utils::EOL);
-            utils::print_question(utils::lfill(input, width), color::green + "⦿ ");
-            cout << answers[input] << endl;
+        out << '\n';
+        map<string, string> result;
+        for (unsigned int i = 0; i < inputs.size(); i++) {
+            out << utils::clear_line<utils::EOL>();
+            utils::print_field(labels[i], true, false);
+            out << answers[i] << '\n';
+            result[inputs[i]] = move(answers[i]);
         }
+        out.flush();
 
-        return answers;
+        return result;
     }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Input
 
     auto input(const string &question,
-               const string &default_value = "") -> string {
+               const string &default_value) -> string {
+        utils::prompt_scope scope("input", question);
+        if (utils::headless()) {// An empty line is an empty answer, as Enter without Tab in the prompt
+            return utils::read_answer(question);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
         // Print default value
-        cout << color::grey << default_value << color::reset;
-        cout << utils::move_left(default_value.size());
+        utils::line_editor answer(utils::answer_column(utils::current_theme().question_symbol, utils::display_width(question)));
+        answer.set_hint(default_value);
 
         // Get answer
-        string answer;
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    cout << endl;
-                    break;
-                } else if (current == 127) {// Backspace
-                    if (!answer.empty()) {
-                        answer.pop_back();
-                        cout << utils::move_left(1);
-                        cout << utils::clear_line(utils::EOL);
-                    }
-                } else if (current == 9) {// Tab
-                    if (answer == default_value.substr(0, answer.length())) {
-                        cout << default_value.substr(answer.length());
-                        answer = default_value;
-                    }
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        // Ignore arrow keys
-                    }
+        out << utils::enable_paste();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                out << '\n';
+                break;
+            } else if (key.code == utils::key::tab) {
+                if (answer.size() <= default_value.size() && answer.text() == default_value.substr(0, answer.size())) {
+                    answer.edit({utils::key::end});
+                    answer.insert(string_view(default_value).substr(answer.size()));
                 }
-            } else {// 'Normal' character
-                answer += current;
-                cout << current;
+            } else {
+                answer.edit(key);
             }
 
             // Check default_value
-            if (answer == default_value.substr(0, answer.length())) {
-                cout << color::grey << default_value.substr(answer.length()) << color::reset;
-                if (answer != default_value) {
-                    cout << utils::move_left(default_value.size() - answer.size());
-                }
-            } else if (answer != default_value) {
-                cout << utils::clear_line(utils::EOL);
+            if (answer.size() <= default_value.size() && answer.text() == default_value.substr(0, answer.size())) {
+                answer.set_hint(default_value.substr(answer.size()));
+            } else {
+                answer.set_hint("");
             }
+            out.flush();
         }
+        out << utils::disable_paste();
         utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        cout << color::cyan << answer << color::reset << endl;
+        string text = answer.text();
+        out << utils::current_theme().answer << text << color::reset << '\n';
+        out.flush();
 
-        return answer;
+        return text;
     }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Invisible
 
     auto invisible(const string &question) -> string {
+        utils::prompt_scope scope("invisible", question);
+        if (utils::headless()) {
+            return utils::read_answer(question);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
         // Get answer
-        string answer;
-        char current;
+        utils::line_editor answer(0, utils::line_editor::echo::none);
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    cout << endl;
-                    break;
-                } else if (current == 127) {// Backspace
-                    if (!answer.empty()) {
-                        answer.pop_back();
-                    }
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        // Ignore arrow keys
-                    }
-                }
-            } else {// 'Normal' character
-                answer += current;
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                out << '\n';
+                break;
             }
+            answer.edit(key);
         }
         utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        cout << endl;
+        out << '\n';
+        out.flush();
 
-        return answer;
+        return answer.text();
     }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // List
 
-    auto list(const string &question) -> vector<string> {
-        // Print question
+    auto list(const string &question,
+              const list_format &format) -> vector<string> {
+        utils::prompt_scope scope("list", question);
+        if (utils::headless()) {
+            return utils::tokenize(utils::read_answer(question), format);
+        }
+
+        auto &out = utils::out();
+
+        // Print question, and the line of the preview under it
+        const size_t start = utils::answer_column(utils::current_theme().question_symbol, utils::display_width(question));
         utils::print_question(question);
+        out << '\n'
+            << utils::move_up<1>() << utils::move_right(start);
 
         // Get answer
-        string answer;
-        char current;
+        utils::line_editor answer(start);
+        utils::list_tokenizer tokens(format);
+        size_t edited = string::npos;// Offset from which the items are outdated
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    cout << endl;
-                    break;
-                } else if (current == 127) {// Backspace
-                    if (!answer.empty()) {
-                        answer.pop_back();
-                        cout << utils::move_left(1);
-                        cout << utils::clear_line(utils::EOL);
-                    }
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        // Ignore arrow keys
-                    }
-                }
-            } else {// 'Normal' character
-                answer += current;
-                cout << current;
+        out << utils::enable_paste();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                out << '\n'
+                    << utils::clear_line<utils::LINE>();
+                break;
+            }
+            const size_t cursor = answer.cursor();
+            const size_t size   = answer.size();
+            answer.edit(key);
+            if (answer.size() != size) {// The text after the lowest cursor changed
+                edited = min(edited, min(cursor, answer.cursor()));
+            }
+
+            // Preview the items once the queued keys are applied
+            if (edited != string::npos && !utils::input_pending()) {
+                tokens.update(answer, edited);
+                edited = string::npos;
+                utils::draw_list_preview(tokens);
             }
+            out.flush();
         }
+        out << utils::disable_paste();
         utils::disable_raw_mode();
+        if (edited != string::npos) {
+            tokens.update(answer, edited);
+        }
 
         // Print resume
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        auto items = utils::split(answer, ',');
+        auto items = tokens.items();
         for (auto it = items.begin(); it != items.end(); it++) {
-            cout << color::cyan << *it << color::reset;
+            out << utils::current_theme().answer << *it << color::reset;
             if (it + 1 != items.end()) {
-                cout << ", ";
+                out << ", ";
             }
         }
-        cout << endl;
+        out << '\n';
+        out.flush();
 
         return items;
     }
@@ -669,94 +2808,90 @@ namespace enquirer {
 
     auto multi_select(const string &question,
                       const vector<string> &choices) -> vector<string> {
+        utils::prompt_scope scope("multi_select", question);
+        if (utils::headless()) {// Comma separated choices, returned in the order of the list
+            utils::selection checked(choices.size());
+            for (const auto &answer: utils::tokenize(utils::read_answer(question), {})) {
+                checked.set(utils::find_choice(question, choices, answer));
+            }
+            return checked.pick(choices);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
-        cout << endl;
+        out << '\n';
 
         unsigned int selected = 0;
-        bool choice[choices.size()];
-        for (unsigned int i = 0; i < choices.size(); i++) {
-            choice[i] = false;
-        }
+        unsigned int anchor   = 0;// Row of the last check, start of the range selections
+        utils::selection choice(choices.size());
 
         // Print choices
-        for (unsigned int i = 0; i < choices.size(); i++) {
-            if (choice[i]) {
-                cout << color::bold << color::green << "✔ " << color::reset;
-            } else {
-                cout << color::grey << "✔ " << color::reset;
-            }
-            if (i == selected) {
-                cout << color::cyan << color::underline << choices[i] << color::reset << endl;
-            } else {
-                cout << choices[i] << endl;
-            }
-        }
+        utils::virtual_screen screen;
+        utils::viewport view = utils::list_viewport(choices.size());
+        utils::draw_multi_select(screen, view, choices, choice, selected);
 
         // Get answer
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        cout << utils::hide_cursor();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    break;
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 65) {// Up
-                            selected = (selected == 0) ? choices.size() - 1 : selected - 1;
-                        } else if (current == 66) {// Down
-                            selected = (selected == choices.size() - 1) ? 0 : selected + 1;
-                        } else if (current == 67) {// Right
-                            choice[selected] = true;
-                        } else if (current == 68) {// Left
-                            choice[selected] = false;
-                        }
-                    }
-                }
+        out << utils::hide_cursor();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                break;
+            } else if (key.code == utils::key::up) {
+                selected = (selected == 0) ? choices.size() - 1 : selected - 1;
+            } else if (key.code == utils::key::down) {
+                selected = (selected == choices.size() - 1) ? 0 : selected + 1;
+            } else if ((key.code == utils::key::right || key.code == utils::key::left) && (key.modifiers & utils::key_event::shift)) {
+                choice.set_range(anchor, selected, key.code == utils::key::right);
+            } else if (key.code == utils::key::right) {
+                choice.set(selected, true);
+                anchor = selected;
+            } else if (key.code == utils::key::left) {
+                choice.set(selected, false);
+                anchor = selected;
+            } else if (key.code == utils::key::character && key.character == ' ') {
+                choice.set(selected, !choice.test(selected));
+                anchor = selected;
+            } else if (key.code == utils::key::character && key.character == 'a') {
+                choice.set_all(!choice.all());
+            } else if (key.code == utils::key::character && key.character == 'i') {
+                choice.invert();
+            } else if (key.code == utils::key::resize) {
+                utils::refit(view, choices.size(), utils::terminal_size().ws_row);
+                screen.invalidate();
+            } else {
+                selected = utils::jump(key.code, selected, choices.size(), view.height);
             }
 
+            // Only draw the state reached after the queued keys
+            if (utils::input_pending()) continue;
+
             // Redraw choices
-            cout << utils::move_up(choices.size())
-                 << utils::move_left(1000);
-            for (unsigned int i = 0; i < choices.size(); i++) {
-                if (choice[i]) {
-                    cout << color::bold << color::green << "✔ " << color::reset;
-                } else {
-                    cout << color::grey << "✔ " << color::reset;
-                }
-                if (i == selected) {
-                    cout << color::cyan << color::underline << choices[i] << color::reset << endl;
-                } else {
-                    cout << choices[i] << endl;
-                }
-            }
+            utils::draw_multi_select(screen, view, choices, choice, selected);
+            out.flush();
         }
-        cout << utils::show_cursor();
+        out << utils::show_cursor();
         utils::disable_raw_mode();
 
         // Print resume
-        for (unsigned int i = 0; i < choices.size(); i++) {// Clear choices
-            cout << utils::move_up() << utils::clear_line(utils::EOL);
+        for (unsigned int i = 0; i < screen.height(); i++) {// Clear choices
+            out << utils::move_up<1>() << utils::clear_line<utils::EOL>();
         }
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        vector<string> items;
-        for (unsigned int i = 0; i < choices.size(); i++) {
-            if (choice[i]) {
-                items.push_back(choices[i]);
-            }
-        }
+        vector<string> items = choice.pick(choices);
         for (auto it = items.begin(); it != items.end(); it++) {
-            cout << color::cyan << *it << color::reset;
+            out << utils::current_theme().answer << *it << color::reset;
             if (it + 1 != items.end()) {
-                cout << ", ";
+                out << ", ";
             }
         }
-        cout << endl;
+        out << '\n';
+        out.flush();
 
         return items;
     }
@@ -765,46 +2900,43 @@ namespace enquirer {
     // Password
 
     auto password(const string &question,
-                  char mask = '*') -> string {
+                  char mask) -> string {
+        utils::prompt_scope scope("password", question);
+        if (utils::headless()) {
+            return utils::read_answer(question);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
         // Get answer
-        string answer;
-        char current;
+        utils::line_editor answer(utils::answer_column(utils::current_theme().question_symbol, utils::display_width(question)), utils::line_editor::echo::mask, mask);
+        utils::key_event key;
         utils::enable_raw_mode();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    cout << endl;
-                    break;
-                } else if (current == 127) {// Backspace
-                    if (!answer.empty()) {
-                        answer.pop_back();
-                        cout << utils::move_left(1);
-                        cout << utils::clear_line(utils::EOL);
-                    }
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        // Ignore arrow keys
-                    }
-                }
-            } else {// 'Normal' character
-                answer += current;
-                cout << mask;
+        out << utils::enable_paste();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                out << '\n';
+                break;
             }
+            answer.edit(key);
+            out.flush();
         }
+        out << utils::disable_paste();
         utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        string text = answer.text();
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        cout << color::cyan << string(answer.size(), mask) << color::reset << endl;
+        out << utils::current_theme().answer << string(utils::char_count(text), mask) << color::reset << '\n';
+        out.flush();
 
-        return answer;
+        return text;
     }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
@@ -813,67 +2945,63 @@ namespace enquirer {
     auto quiz(const string &question,
               const vector<string> &choices,
               const string &correct) -> bool {
+        utils::prompt_scope scope("quiz", question);
+        if (utils::headless()) {
+            return choices[utils::find_choice(question, choices, utils::read_answer(question))] == correct;
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
-        cout << endl;
+        out << '\n';
 
         unsigned int choice = 0;
 
         // Print choices
-        for (unsigned int i = 0; i < choices.size(); i++) {
-            if (i == choice) {
-                cout << color::cyan << color::bold << "> " << color::reset
-                     << color::cyan << color::underline << choices[i] << color::reset << endl;
-            } else {
-                cout << "  " << choices[i] << endl;
-            }
-        }
+        utils::virtual_screen screen;
+        utils::viewport view = utils::list_viewport(choices.size());
+        utils::draw_select(screen, view, choices, choice);
 
         // Get answer
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        cout << utils::hide_cursor();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    break;
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 65) {// Up
-                            choice = (choice == 0) ? choices.size() - 1 : choice - 1;
-                        } else if (current == 66) {// Down
-                            choice = (choice == choices.size() - 1) ? 0 : choice + 1;
-                        }
-                    }
-                }
+        out << utils::hide_cursor();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                break;
+            } else if (key.code == utils::key::up) {
+                choice = (choice == 0) ? choices.size() - 1 : choice - 1;
+            } else if (key.code == utils::key::down) {
+                choice = (choice == choices.size() - 1) ? 0 : choice + 1;
+            } else if (key.code == utils::key::resize) {
+                utils::refit(view, choices.size(), utils::terminal_size().ws_row);
+                screen.invalidate();
+            } else {
+                choice = utils::jump(key.code, choice, choices.size(), view.height);
             }
 
+            // Draw once for all the queued keys
+            if (utils::input_pending()) continue;
+
             // Redraw choices
-            cout << utils::move_up(choices.size())
-                 << utils::move_left(1000);
-            for (unsigned int i = 0; i < choices.size(); i++) {
-                if (i == choice) {
-                    cout << color::cyan << color::bold << "> " << color::reset
-                         << color::cyan << color::underline << choices[i] << color::reset << endl;
-                } else {
-                    cout << "  " << choices[i] << endl;
-                }
-            }
+            utils::draw_select(screen, view, choices, choice);
+            out.flush();
         }
-        cout << utils::show_cursor();
+        out << utils::show_cursor();
         utils::disable_raw_mode();
 
         // Print resume
-        for (unsigned int i = 0; i < choices.size(); i++) {// Clear choices
-            cout << utils::move_up() << utils::clear_line(utils::EOL);
+        for (unsigned int i = 0; i < screen.height(); i++) {// Clear choices
+            out << utils::move_up<1>() << utils::clear_line<utils::EOL>();
         }
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
         bool result = (choices[choice] == correct);
-        cout << (result ? color::green : color::red) << choices[choice] << color::reset << endl;
+        out << (result ? utils::current_theme().success : utils::current_theme().failure) << choices[choice] << color::reset << '\n';
+        out.flush();
 
         return result;
     }
@@ -881,70 +3009,100 @@ namespace enquirer {
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
     // Select
 
-    auto select(const string &question,
-                const vector<string> &choices) -> string {
+    static auto streamed_select(const string &question,
+                                const vector<string> &choices,
+                                utils::choice_stream stream) -> string {
+        utils::prompt_scope scope("select", question);
+        if (utils::headless()) {
+            string answer = utils::read_answer(question);
+            while (stream.loading()) {// Every choice is needed to check the answer
+                struct pollfd fd = {stream.source->fd(), POLLIN, 0};
+                poll(&fd, 1, -1);
+                stream.source->fetch(*stream.choices);
+            }
+            return choices[utils::find_choice(question, choices, answer)];
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
-        cout << endl;
+        out << '\n';
 
         unsigned int choice = 0;
 
         // Print choices
-        for (unsigned int i = 0; i < choices.size(); i++) {
-            if (i == choice) {
-                cout << color::cyan << color::bold << "> " << color::reset
-                     << color::cyan << color::underline << choices[i] << color::reset << endl;
-            } else {
-                cout << "  " << choices[i] << endl;
-            }
-        }
+        stream.fetch();
+        bool loading = stream.loading();
+        utils::virtual_screen screen;
+        utils::viewport view = utils::list_viewport(choices.size(), loading ? 1 : 0);
+        utils::draw_select(screen, view, choices, choice, loading);
 
         // Get answer
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        cout << utils::hide_cursor();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    break;
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 65) {// Up
-                            choice = (choice == 0) ? choices.size() - 1 : choice - 1;
-                        } else if (current == 66) {// Down
-                            choice = (choice == choices.size() - 1) ? 0 : choice + 1;
-                        }
-                    }
+        out << utils::hide_cursor();
+        out.flush();
+        while (true) {
+            if (utils::wait_key(stream)) {
+                if (!utils::read_key(key)) break;
+
+                if (key.code == utils::key::enter) {
+                    if (!choices.empty() || !stream.loading()) break;
+                } else if (key.code == utils::key::resize) {
+                    utils::refit(view, choices.size(), utils::terminal_size().ws_row, loading ? 1 : 0);
+                    screen.invalidate();
+                } else if (choices.empty()) {
+                    // Nothing to move to yet
+                } else if (key.code == utils::key::up) {
+                    choice = (choice == 0) ? choices.size() - 1 : choice - 1;
+                } else if (key.code == utils::key::down) {
+                    choice = (choice == choices.size() - 1) ? 0 : choice + 1;
+                } else {
+                    choice = utils::jump(key.code, choice, choices.size(), view.height);
                 }
             }
 
-            // Redraw choices
-            cout << utils::move_up(choices.size())
-                 << utils::move_left(1000);
-            for (unsigned int i = 0; i < choices.size(); i++) {
-                if (i == choice) {
-                    cout << color::cyan << color::bold << "> " << color::reset
-                         << color::cyan << color::underline << choices[i] << color::reset << endl;
-                } else {
-                    cout << "  " << choices[i] << endl;
-                }
+            // Apply every key already typed before drawing, e.g. an auto-repeated arrow
+            if (utils::input_pending()) continue;
+
+            // Grow the viewport with the choices which arrived in the meantime
+            if (stream.fetch() || loading != stream.loading()) {
+                loading = stream.loading();
+                utils::refit(view, choices.size(), utils::terminal_size().ws_row, loading ? 1 : 0);
             }
+
+            // Redraw choices
+            utils::draw_select(screen, view, choices, choice, loading);
+            out.flush();
         }
-        cout << utils::show_cursor();
+        out << utils::show_cursor();
         utils::disable_raw_mode();
 
+        string answer = choices.empty() ? "" : choices[choice];
+
         // Print resume
-        for (unsigned int i = 0; i < choices.size(); i++) {// Clear choices
-            cout << utils::move_up() << utils::clear_line(utils::EOL);
+        for (unsigned int i = 0; i < screen.height(); i++) {// Clear choices
+            out << utils::move_up<1>() << utils::clear_line<utils::EOL>();
         }
-        cout << utils::move_up()
-             << utils::move_left(1000);
+        out << utils::move_up<1>()
+            << utils::move_left<1000>();
         utils::print_answer(question);
-        cout << color::cyan << choices[choice] << color::reset << endl;
+        out << utils::current_theme().answer << answer << color::reset << '\n';
+        out.flush();
+
+        return answer;
+    }
+
+    auto select(const string &question,
+                const vector<string> &choices) -> string {
+        return streamed_select(question, choices, {});
+    }
 
-        return choices[choice];
+    auto select(const string &question,
+                choice_source &source) -> string {
+        vector<string> choices;
+        return streamed_select(question, choices, {&source, &choices});
     }
 
     // _.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-._.-.
@@ -953,49 +3111,56 @@ namespace enquirer {
     auto toggle(const string &question,
                 const string &enable,
                 const string &disable,
-                bool default_value = false) -> bool {
+                bool default_value) -> bool {
+        utils::prompt_scope scope("toggle", question);
+        if (utils::headless()) {
+            string answer = utils::read_answer(question);
+            if (answer.empty()) return default_value;
+            if (answer == enable) return true;
+            if (answer == disable) return false;
+            return utils::parse_yes_no(question, answer);
+        }
+
+        auto &out = utils::out();
+
         // Print question
         utils::print_question(question);
 
         // Print choices
-        bool toggled = default_value;
-        cout << (toggled ? color::cyan + color::underline : "") << enable << color::reset << "/"
-             << (toggled ? "" : color::cyan + color::underline) << disable << color::reset;
+        bool toggled       = default_value;
+        const size_t width = utils::display_width(enable) + utils::display_width(disable) + 1;
+        out << (toggled ? utils::current_theme().highlight : style()) << enable << color::reset << "/"
+            << (toggled ? style() : utils::current_theme().highlight) << disable << color::reset;
 
         // Get answer
-        char current;
+        utils::key_event key;
         utils::enable_raw_mode();
-        cout << utils::hide_cursor();
-        while (cin.get(current)) {
-            if (iscntrl(current)) {
-                if (current == 10) {// Enter
-                    break;
-                } else if (current == 27) {// Escape
-                    cin.get(current);
-                    if (current == 91) {
-                        cin.get(current);
-                        if (current == 68) {// Left
-                            toggled = true;
-                        } else if (current == 67) {// Right
-                            toggled = false;
-                        }
-                    }
-                }
+        out << utils::hide_cursor();
+        out.flush();
+        while (utils::read_key(key)) {
+            if (key.code == utils::key::enter) {
+                break;
+            } else if (key.code == utils::key::left) {
+                toggled = true;
+            } else if (key.code == utils::key::right) {
+                toggled = false;
             }
 
             // Redraw choices
-            cout << utils::move_left(enable.length() + disable.length() + 1)
-                 << utils::clear_line(utils::EOL)
-                 << (toggled ? color::cyan + color::underline : "") << enable << color::reset << "/"
-                 << (toggled ? "" : color::cyan + color::underline) << disable << color::reset;
+            out << utils::move_left(width)
+                << utils::clear_line<utils::EOL>()
+                << (toggled ? utils::current_theme().highlight : style()) << enable << color::reset << "/"
+                << (toggled ? style() : utils::current_theme().highlight) << disable << color::reset;
+            out.flush();
         }
-        cout << utils::show_cursor();
+        out << utils::show_cursor();
         utils::disable_raw_mode();
 
         // Print resume
-        cout << utils::move_left(1000);
+        out << utils::move_left<1000>();
         utils::print_answer(question);
-        cout << (toggled ? color::green : color::red) << (toggled ? enable : disable) << color::reset << endl;
+        out << (toggled ? utils::current_theme().success : utils::current_theme().failure) << (toggled ? enable : disable) << color::reset << '\n';
+        out.flush();
 
         return toggled;
     }
@@ -22,9 +22,15 @@
  * SOFTWARE.
  */
 #include <enquirer.h>
+#include <csignal>
+#include <fcntl.h>
 #include <functional>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
 
 using namespace std;
 using namespace ::testing;
@@ -35,10 +41,72 @@ namespace utils_char {
     const string arrow_right = "\e[C";
     const string arrow_left  = "\e[D";
 
+    const string shift_right = "\e[1;2C";
+    const string shift_left  = "\e[1;2D";
+
+    const string ctrl_left  = "\e[1;5D";
+    const string ctrl_right = "\e[1;5C";
+
     const string tab = "\t";
-    const string del = "\x7F";
+
+    const string ctrl_a = "\x01";
+    const string ctrl_e = "\x05";
+    const string ctrl_k = "\x0B";
+    const string ctrl_u = "\x15";
+    const string ctrl_w = "\x17";
+    const string ctrl_y = "\x19";
+
+    const string paste_begin = "\e[200~";
+    const string paste_end   = "\e[201~";
+    const string del        = "\x7F";
+    const string delete_key = "\e[3~";
 }// namespace utils_char
 
+// The tests type their keys in a redirected std::cin, as if the prompts were displayed in a terminal
+class interactive_environment : public Environment {
+public:
+    auto SetUp() -> void override {
+        enquirer::set_prompt_mode(enquirer::prompt_mode::interactive);
+    }
+};
+
+static Environment *const interactive = AddGlobalTestEnvironment(new interactive_environment);
+
+// Give the keys to the prompts in chunks, a chunk is only read once the frames of the previous one are drawn
+class typing_buffer : public streambuf {
+public:
+    typing_buffer(vector<string> chunks, const stringstream &output) : chunks(std::move(chunks)), output(output) {}
+
+    // Size of the output when each chunk after the first began to be read
+    vector<size_t> marks;
+
+protected:
+    auto showmanyc() -> streamsize override {
+        return (chunk < chunks.size()) ? (streamsize) (chunks[chunk].size() - position) : 0;
+    }
+
+    auto underflow() -> int_type override {
+        while (chunk < chunks.size() && position == chunks[chunk].size()) {
+            chunk++;
+            position = 0;
+            marks.push_back(output.str().size());
+        }
+        return (chunk < chunks.size()) ? traits_type::to_int_type(chunks[chunk][position]) : traits_type::eof();
+    }
+
+    auto uflow() -> int_type override {
+        const int_type c = underflow();
+        if (c != traits_type::eof()) position++;
+        return c;
+    }
+
+private:
+    vector<string> chunks;
+    const stringstream &output;
+    size_t chunk    = 0;
+    size_t position = 0;
+};
+
 auto execWithCinRedirected(const function<void(stringstream &stream)> &function) -> void {
     stringstream input_stream;
     streambuf *old = cin.rdbuf(input_stream.rdbuf());
@@ -46,6 +114,15 @@ auto execWithCinRedirected(const function<void(stringstream &stream)> &function)
     cin.rdbuf(old);
 }
 
+// Read what is left in the input decoder shared by the tests, e.g. the resize reported after a test changed the
+// terminal size
+auto drainKeys() -> void {
+    execWithCinRedirected([](stringstream &) {
+        enquirer::utils::key_event event;
+        while (enquirer::utils::read_key(event)) {}
+    });
+}
+
 TEST(enquirer, auth_1) {
     execWithCinRedirected([](stringstream &stream) {
         stream << "username" << utils_char::arrow_down << "password" << endl;
@@ -106,6 +183,98 @@ TEST(enquirer, autocomplete) {
         string result = enquirer::autocomplete("", {"abcde", "abcdef"});
         ASSERT_STREQ("abcde", result.c_str());
     });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "ap" << utils_char::arrow_down << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"banana", "apricot", "cherry", "apple", "ap"});
+        ASSERT_STREQ("apple", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "apr" << utils_char::del << utils_char::del << "x" << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"banana", "apricot", "axe"});
+        ASSERT_STREQ("axe", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "z" << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"banana", "apricot", "axe"});
+        ASSERT_STREQ("z", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "bcx" << utils_char::del << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"ab", "bcd", "bce", "b", "bcb"});
+        ASSERT_STREQ("bcb", result.c_str());
+    });
+}
+
+TEST(enquirer, autocomplete_fuzzy) {
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "enqh" << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"src/enquirer.cpp", "include/enquirer.h", "README.md"}, 10, enquirer::match_mode::fuzzy);
+        ASSERT_STREQ("include/enquirer.h", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "abc" << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"a_b_c", "xaxbxcx", "abc_long", "abc"}, 10, enquirer::match_mode::fuzzy);
+        ASSERT_STREQ("abc", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "rdx" << utils_char::del << utils_char::arrow_down << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"README.md", "Random", "nope"}, 10, enquirer::match_mode::fuzzy);
+        ASSERT_STREQ("README.md", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "zz" << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", {"README.md", "Random"}, 10, enquirer::match_mode::fuzzy);
+        ASSERT_STREQ("zz", result.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Found past the first blocks of 16 bytes, in upper case
+        stream << "zmain" << utils_char::tab << endl;
+        const string path = string(40, 'a') + "z/src/" + string(20, 'b') + "/MAIN.cpp";
+        string result     = enquirer::autocomplete("", {"zmai", path}, 10, enquirer::match_mode::fuzzy);
+        ASSERT_EQ(path, result);
+    });
+}
+
+TEST(enquirer, autocomplete_fuzzy_threads) {
+    vector<string> choices;
+    for (unsigned int i = 0; i < 100000; i++) {
+        choices.push_back("host-" + to_string(i) + ".example.org");
+    }
+    choices.emplace_back("h-9.e");
+
+    enquirer::set_match_threads(4);
+    execWithCinRedirected([&choices](stringstream &stream) {
+        stream << "h9e" << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", choices, 10, enquirer::match_mode::fuzzy);
+        ASSERT_STREQ("h-9.e", result.c_str());
+    });
+
+    execWithCinRedirected([&choices](stringstream &stream) {
+        stream << "h99999" << utils_char::del << utils_char::tab << endl;
+        string result = enquirer::autocomplete("", choices, 10, enquirer::match_mode::fuzzy);
+        ASSERT_STREQ("host-9999.example.org", result.c_str());
+    });
+    enquirer::set_match_threads(1);
+}
+
+TEST(enquirer, autocomplete_source) {
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "ap" << utils_char::tab << endl;
+        enquirer::choice_source source;
+        for (const auto &choice: {"banana", "apricot", "apple"}) {
+            source.push(choice);
+        }
+        source.close();
+        string res = enquirer::autocomplete("Fruit", source);
+        ASSERT_STREQ("apple", res.c_str());
+    });
 }
 
 TEST(enquirer, confirm) {
@@ -192,6 +361,26 @@ TEST(enquirer, form) {
     });
 }
 
+TEST(enquirer, formOrder) {
+    execWithCinRedirected([](stringstream &stream) {// Enter jumps to the first empty input of the list, not of the labels sorted
+        stream << "z" << utils_char::arrow_down << utils_char::arrow_down
+               << "m" << endl
+               << "a" << endl;
+        auto answers = enquirer::form("Order", {"Zeta", "Alpha", "Mid"});
+        ASSERT_EQ("z", answers["Zeta"]);
+        ASSERT_EQ("a", answers["Alpha"]);
+        ASSERT_EQ("m", answers["Mid"]);
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Backspace removes a whole character, not its last byte
+        stream << "Zoë" << utils_char::del << "e\u0301" << utils_char::del << "é" << endl
+               << "a" << endl
+               << "m" << endl;
+        auto answers = enquirer::form("Order", {"Zeta", "Alpha", "Mid"});
+        ASSERT_EQ("Zoé", answers["Zeta"]);
+    });
+}
+
 TEST(enquirer, input) {
     execWithCinRedirected([](stringstream &stream) {
         stream << "Hello world!" << endl;
@@ -204,6 +393,47 @@ TEST(enquirer, input) {
         string res = enquirer::input("Type something", "John");
         ASSERT_STREQ("John", res.c_str());
     });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "> " << utils_char::paste_begin << "Hello\r\nworld\e[A!" << utils_char::paste_end << endl;
+        string res = enquirer::input("Type something");
+        ASSERT_STREQ("> Helloworld[A!", res.c_str());// Control characters of the paste are dropped
+    });
+}
+
+TEST(enquirer, inputEditing) {
+    execWithCinRedirected([](stringstream &stream) {// Insert and delete in the middle
+        stream << "abcdef" << utils_char::arrow_left << utils_char::arrow_left
+               << utils_char::del << utils_char::delete_key << "Z" << endl;
+        ASSERT_EQ("abcZf", enquirer::input("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Word jumps and kill to the end
+        stream << "one two three" << utils_char::ctrl_left << utils_char::ctrl_left
+               << utils_char::ctrl_k << utils_char::ctrl_right << "2" << endl;
+        ASSERT_EQ("one 2", enquirer::input("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Kill a word and yank it at the beginning
+        stream << "hello world" << utils_char::ctrl_w << utils_char::ctrl_a
+               << utils_char::ctrl_y << utils_char::ctrl_e << "!" << endl;
+        ASSERT_EQ("worldhello !", enquirer::input("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Multibyte characters are moved over at once
+        stream << "aé" << utils_char::arrow_left << utils_char::del << "b" << endl;
+        ASSERT_EQ("bé", enquirer::input("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "secret" << utils_char::ctrl_u << "pass" << utils_char::arrow_left << "_" << endl;
+        ASSERT_EQ("pas_s", enquirer::password("Password"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "12" << utils_char::arrow_left << utils_char::arrow_left << "-" << utils_char::ctrl_a << "3" << endl;
+        ASSERT_EQ(-12, enquirer::number<int>("Number"));
+    });
 }
 
 TEST(enquirer, invisible) {
@@ -243,6 +473,12 @@ TEST(enquirer, list) {
         ASSERT_STREQ("f", res[5].c_str());
     });
 
+    execWithCinRedirected([](stringstream &stream) {
+        stream << utils_char::paste_begin << "a,b,\nc" << utils_char::paste_end << endl;
+        auto res = enquirer::list("Type something");
+        ASSERT_THAT(res, ElementsAre("a", "b", "c"));
+    });
+
     execWithCinRedirected([](stringstream &stream) {
         stream << ", b, c" << endl;
         auto res = enquirer::list("Type something");
@@ -271,6 +507,23 @@ TEST(enquirer, list) {
     });
 }
 
+TEST(enquirer, listFormat) {
+    execWithCinRedirected([](stringstream &stream) {// Quoted delimiters and a doubled quote
+        stream << "a, \"b, c\", \"say \"\"hi\"\"\"" << endl;
+        ASSERT_THAT(enquirer::list("Type something"), ElementsAre("a", "b, c", "say \"hi\""));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "a;b c" << endl;
+        ASSERT_THAT(enquirer::list("Type something", {"; ", 0}), ElementsAre("a", "b", "c"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Edited in the middle after the items were tokenized
+        stream << "aa, bb, cc" << utils_char::ctrl_left << utils_char::ctrl_left << utils_char::del << ";" << endl;
+        ASSERT_THAT(enquirer::list("Type something", {",;"}), ElementsAre("aa", "", "bb", "cc"));
+    });
+}
+
 TEST(enquirer, multiSelect) {
     execWithCinRedirected([](stringstream &stream) {
         stream << endl;
@@ -312,12 +565,87 @@ TEST(enquirer, multiSelect) {
     });
 }
 
+TEST(enquirer, multiSelectBulk) {
+    vector<string> choices;
+    for (int i = 0; i < 150; i++) {
+        choices.push_back(to_string(i));
+    }
+
+    execWithCinRedirected([&](stringstream &stream) {// Select all
+        stream << "a" << endl;
+        auto res = enquirer::multi_select("Choose", choices);
+        ASSERT_EQ(choices, res);
+    });
+
+    execWithCinRedirected([&](stringstream &stream) {// Select all twice clears
+        stream << "aa" << endl;
+        ASSERT_THAT(enquirer::multi_select("Choose", choices), IsEmpty());
+    });
+
+    execWithCinRedirected([&](stringstream &stream) {// Invert after a check
+        stream << utils_char::arrow_right << "i" << endl;
+        auto res = enquirer::multi_select("Choose", choices);
+        ASSERT_EQ(vector<string>(choices.begin() + 1, choices.end()), res);
+    });
+
+    execWithCinRedirected([&](stringstream &stream) {// Range across words, then unchecked in the middle
+        stream << utils_char::arrow_down << utils_char::arrow_right;
+        for (int i = 0; i < 69; i++) stream << utils_char::arrow_down;
+        stream << utils_char::shift_right;
+        stream << utils_char::arrow_up << " " << utils_char::arrow_up << utils_char::shift_left
+               << endl;
+        auto res = enquirer::multi_select("Choose", choices);
+        ASSERT_THAT(res, ElementsAre("1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14",
+                                     "15", "16", "17", "18", "19", "20", "21", "22", "23", "24", "25", "26", "27",
+                                     "28", "29", "30", "31", "32", "33", "34", "35", "36", "37", "38", "39", "40",
+                                     "41", "42", "43", "44", "45", "46", "47", "48", "49", "50", "51", "52", "53",
+                                     "54", "55", "56", "57", "58", "59", "60", "61", "62", "63", "64", "65", "66",
+                                     "67", "70"));
+    });
+}
+
 TEST(enquirer, number) {
     execWithCinRedirected([](stringstream &stream) {
         stream << "1" << endl;
         auto res = enquirer::number<int>("Type something");
         ASSERT_EQ(1, res);
     });
+
+    execWithCinRedirected([](stringstream &stream) {// No point for integers
+        stream << "3.5" << endl;
+        ASSERT_EQ(35, enquirer::number<int>("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// The keys overflowing N are dropped
+        stream << "40000" << endl;
+        ASSERT_EQ(4000, enquirer::number<short>("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "-5" << endl;
+        ASSERT_EQ(5u, enquirer::number<unsigned int>("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "-0x1Fg" << endl;
+        ASSERT_EQ(-31, enquirer::number<int>("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Enter is ignored while the exponent is incomplete
+        stream << "1.5e" << endl
+               << "3" << endl;
+        ASSERT_EQ(1500.0, enquirer::number<double>("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "1e400" << endl;
+        ASSERT_EQ(1e40, enquirer::number<double>("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "0x1.8p1" << endl;
+        ASSERT_EQ(3.0f, enquirer::number<float>("Type something"));
+    });
 }
 
 TEST(enquirer, password) {
@@ -383,6 +711,228 @@ TEST(enquirer, select) {
         string res = enquirer::select("Choose", {"a", "b", "c"});
         ASSERT_STREQ("c", res.c_str());
     });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << utils_char::arrow_down << utils_char::arrow_down
+               << utils_char::arrow_down << utils_char::arrow_down << endl;
+        string res = enquirer::select("Choose", {"a", "b", "c"});
+        ASSERT_STREQ("b", res.c_str());
+    });
+}
+
+TEST(enquirer, select_redraw) {
+    stringstream output;
+    typing_buffer keys({"", utils_char::arrow_down, "\n"}, output);
+    streambuf *old_in  = cin.rdbuf(&keys);
+    streambuf *old_out = cout.rdbuf(output.rdbuf());
+    enquirer::set_flush_policy(enquirer::flush_policy::stream);
+    string res = enquirer::select("Choose", {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"});
+    enquirer::set_flush_policy(enquirer::flush_policy::frame);
+    cout.rdbuf(old_out);
+    cin.rdbuf(old_in);
+
+    ASSERT_STREQ("1", res.c_str());
+    ASSERT_EQ(2U, keys.marks.size());
+
+    // The frame of the arrow only rewrites the rows losing and gaining the highlight
+    const string frame        = output.str().substr(keys.marks[0], keys.marks[1] - keys.marks[0]);
+    const string_view rewrite = "\r\033[2K";
+    size_t rows               = 0;
+    for (size_t i = frame.find(rewrite); i != string::npos; i = frame.find(rewrite, i + 1)) {
+        rows++;
+    }
+    ASSERT_EQ(2U, rows);
+    ASSERT_NE(string::npos, frame.find("  0"));
+    ASSERT_NE(string::npos, frame.find(string(enquirer::color::reset | enquirer::theme().highlight) + "1"));
+}
+
+TEST(enquirer, select_source) {
+    execWithCinRedirected([](stringstream &stream) {
+        stream << utils_char::arrow_up << endl;
+        enquirer::choice_source source;
+        source.push("a");
+        source.push("b");
+        source.push("c");
+        source.close();
+        string res = enquirer::select("Choose", source);
+        ASSERT_STREQ("c", res.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << utils_char::arrow_down << endl;
+        enquirer::choice_source source;
+        source.close();
+        string res = enquirer::select("Choose", source);
+        ASSERT_STREQ("", res.c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// An endless producer is stopped when the source is destroyed
+        stream << endl;
+        enquirer::choice_source source([](enquirer::choice_source &source) {
+            for (size_t i = 0; source.push(to_string(i)); i++) {}
+        });
+        enquirer::select("Choose", source);
+    });
+
+    enquirer::choice_source source;
+    ASSERT_TRUE(source.push("a"));
+    source.cancel();
+    ASSERT_TRUE(source.cancelled());
+    ASSERT_FALSE(source.push("b"));
+}
+
+TEST(enquirer, select_keys) {
+    vector<string> choices;
+    for (int i = 0; i < 100; i++) {
+        choices.push_back(to_string(i));
+    }
+
+    execWithCinRedirected([&choices](stringstream &stream) {
+        stream << "\e[F" << endl;// End
+        string res = enquirer::select("Choose", choices);
+        ASSERT_STREQ("99", res.c_str());
+    });
+
+    execWithCinRedirected([&choices](stringstream &stream) {
+        stream << "\e[4~\e[1~" << utils_char::arrow_down << endl;// End, Home
+        string res = enquirer::select("Choose", choices);
+        ASSERT_STREQ("1", res.c_str());
+    });
+}
+
+TEST(enquirer, select_coalesce) {
+    execWithCinRedirected([](stringstream &stream) {
+        for (int i = 0; i < 25; i++) {
+            stream << utils_char::arrow_down;
+        }
+        stream << endl;
+
+        stringstream output;
+        streambuf *old = cout.rdbuf(output.rdbuf());
+        enquirer::set_flush_policy(enquirer::flush_policy::stream);
+        string res = enquirer::select("Choose", {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"});
+        enquirer::set_flush_policy(enquirer::flush_policy::frame);
+        cout.rdbuf(old);
+
+        ASSERT_STREQ("5", res.c_str());
+        // Only the first frame, the arrows and Enter were already typed
+        string frames = output.str();
+        const enquirer::style highlight = enquirer::color::reset | enquirer::theme().highlight;
+        size_t highlighted              = 0;
+        for (size_t i = frames.find(highlight); i != string::npos; i = frames.find(highlight, i + 1)) {
+            highlighted++;
+        }
+        ASSERT_EQ(1U, highlighted);
+    });
+}
+
+TEST(enquirer, style) {
+    static_assert(string_view(enquirer::color::bold | enquirer::color::cyan) == "\033[1;36m");
+    static_assert(string_view(enquirer::color::cyan | enquirer::color::red) == "\033[31m");// The last color wins
+    static_assert(string_view(enquirer::color::reset | enquirer::color::underline | enquirer::color::grey) == "\033[0;4;90m");
+    static_assert(string_view(enquirer::style()).empty());
+
+    // Code written for the string colors
+    ASSERT_EQ("\033[32m> ", enquirer::color::green + "> ");
+    const string red = enquirer::color::red;
+    ASSERT_EQ("\033[31m", red);
+    ASSERT_EQ(5U, [](const string &sequence) { return sequence.size(); }(enquirer::color::red));
+}
+
+TEST(enquirer, theme) {
+    enquirer::theme theme;
+    theme.question_symbol = "Q ";
+    theme.answered_symbol = "A ";
+    theme.answer          = enquirer::color::magenta;
+    enquirer::set_theme(theme);
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "x" << endl;
+
+        stringstream output;
+        streambuf *old = cout.rdbuf(output.rdbuf());
+        enquirer::set_flush_policy(enquirer::flush_policy::stream);
+        string res = enquirer::input("Name");
+        enquirer::set_flush_policy(enquirer::flush_policy::frame);
+        cout.rdbuf(old);
+
+        ASSERT_EQ("x", res);
+        ASSERT_NE(string::npos, output.str().find("Q \033[0mName"));
+        ASSERT_NE(string::npos, output.str().find("A \033[0mName"));
+        ASSERT_NE(string::npos, output.str().find("\033[35mx"));
+    });
+    enquirer::set_theme({});
+}
+
+TEST(enquirer, metrics) {
+    vector<enquirer::prompt_metrics> reports;
+    enquirer::set_metrics_observer([&reports](const enquirer::prompt_metrics &metrics) {
+        reports.push_back(metrics);
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "ap" << endl;
+        enquirer::autocomplete("Fruit", {"apple", "banana"});
+    });
+    enquirer::set_metrics_observer(nullptr);
+    execWithCinRedirected([](stringstream &stream) {
+        stream << endl;
+        enquirer::input("Ignored");
+    });
+
+    ASSERT_EQ(1U, reports.size());
+    ASSERT_EQ("autocomplete", reports[0].prompt);
+    ASSERT_STREQ("Fruit", reports[0].question.c_str());
+    ASSERT_EQ(3U, reports[0].keystrokes);
+    ASSERT_GT(reports[0].frames, 0U);
+    ASSERT_GT(reports[0].bytes, 0U);
+    ASSERT_GE(reports[0].wall, reports[0].matching + reports[0].waiting);
+}
+
+TEST(enquirer, terminal_session) {
+    execWithCinRedirected([](stringstream &stream) {
+        stream << utils_char::arrow_down << endl
+               << "bob" << endl;
+        enquirer::terminal_session session;
+        string choice = enquirer::select("Choose", {"a", "b", "c"});
+        string name   = enquirer::input("Name");
+        ASSERT_STREQ("b", choice.c_str());
+        ASSERT_STREQ("bob", name.c_str());
+    });
+}
+
+TEST(enquirer, terminal_session_exception) {
+    // A pseudo terminal as stdin, to check the terminal modes restored
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    ASSERT_GE(master, 0);
+    ASSERT_EQ(0, grantpt(master));
+    ASSERT_EQ(0, unlockpt(master));
+    int terminal = open(ptsname(master), O_RDWR | O_NOCTTY);
+    ASSERT_GE(terminal, 0);
+    int old_stdin = dup(STDIN_FILENO);
+    dup2(terminal, STDIN_FILENO);
+
+    struct failing_buffer : public streambuf {
+        auto underflow() -> int_type override {
+            throw runtime_error("read failed");
+        }
+    } buffer;
+    streambuf *old = cin.rdbuf(&buffer);
+    try {
+        enquirer::terminal_session session;
+        enquirer::input("Name");
+        FAIL();
+    } catch (const runtime_error &) {}
+    cin.rdbuf(old);
+
+    struct termios term {};
+    tcgetattr(STDIN_FILENO, &term);
+    dup2(old_stdin, STDIN_FILENO);
+    close(old_stdin);
+    close(terminal);
+    close(master);
+    ASSERT_TRUE(term.c_lflag & ECHO);
+    ASSERT_TRUE(term.c_lflag & ICANON);
 }
 
 TEST(enquirer, toggle) {
@@ -412,3 +962,434 @@ TEST(enquirer, toggle) {
         ASSERT_FALSE(res);
     });
 }
+
+TEST(utils, escape_sequences) {
+    static_assert(enquirer::utils::move_up<1>() == "\033[1A");
+    static_assert(enquirer::utils::move_left<1000>() == "\033[1000D");
+    static_assert(enquirer::utils::clear_line<enquirer::utils::LINE>() == "\033[2K");
+
+    ASSERT_STREQ("\033[12A", string(enquirer::utils::move_up(12)).c_str());
+    ASSERT_STREQ("\033[3B", string(enquirer::utils::move_down(3)).c_str());
+    ASSERT_STREQ("\033[4294967295C", string(enquirer::utils::move_right(4294967295U)).c_str());
+    ASSERT_STREQ("\033[0K", string(enquirer::utils::clear_line(enquirer::utils::EOL)).c_str());
+}
+
+// Gives the bytes one by one to split the escape sequences between reads
+class trickle_buffer : public streambuf {
+public:
+    explicit trickle_buffer(string data) : data(std::move(data)) {}
+
+protected:
+    auto showmanyc() -> streamsize override {
+        return (position < data.size()) ? 1 : -1;
+    }
+
+    auto underflow() -> int_type override {
+        if (position >= data.size()) return traits_type::eof();
+        setg(&data[position], &data[position], &data[position] + 1);
+        position++;
+        return traits_type::to_int_type(data[position - 1]);
+    }
+
+private:
+    string data;
+    size_t position = 0;
+};
+
+TEST(utils, read_key) {
+    using enquirer::utils::key;
+    using enquirer::utils::key_event;
+
+    drainKeys();// Nothing left by the previous tests
+    trickle_buffer input("a\e[1;5C\e[5~\eOH\e[3~\e[Z\ex\x01\e[15~\n\e");
+    streambuf *old = cin.rdbuf(&input);
+    vector<key_event> events;
+    key_event event;
+    while (enquirer::utils::read_key(event)) {
+        events.push_back(event);
+    }
+    cin.rdbuf(old);
+
+    ASSERT_EQ(11U, events.size());
+    ASSERT_EQ(key::character, events[0].code);
+    ASSERT_EQ('a', events[0].character);
+    ASSERT_EQ(key::right, events[1].code);
+    ASSERT_EQ(key_event::ctrl, events[1].modifiers);
+    ASSERT_EQ(key::page_up, events[2].code);
+    ASSERT_EQ(key::home, events[3].code);
+    ASSERT_EQ(key::del, events[4].code);
+    ASSERT_EQ(key::tab, events[5].code);
+    ASSERT_EQ(key_event::shift, events[5].modifiers);
+    ASSERT_EQ(key::character, events[6].code);
+    ASSERT_EQ(key_event::alt, events[6].modifiers);
+    ASSERT_EQ(key::control, events[7].code);
+    ASSERT_EQ(key::unknown, events[8].code);// F5
+    ASSERT_EQ(key::enter, events[9].code);
+    ASSERT_EQ(key::escape, events[10].code);// Never completed
+}
+
+TEST(utils, display_width) {
+    ASSERT_EQ(0, enquirer::utils::display_width(""));
+    ASSERT_EQ(26, enquirer::utils::display_width("abcdefghijklmnopqrstuvwxyz"));// ASCII fast path and its remainder
+    ASSERT_EQ(4, enquirer::utils::display_width("日本"));                       // Wide
+    ASSERT_EQ(14, enquirer::utils::display_width("0123456789日本"));            // Fast path stopped by a wide character
+    ASSERT_EQ(4, enquirer::utils::display_width("cafe\u0301"));               // Combining mark
+    ASSERT_EQ(4, enquirer::utils::display_width("✔ 😀"));                      // Narrow symbol, space, wide emoji
+    ASSERT_EQ(0, enquirer::utils::display_width("\e"));                       // Control character
+    ASSERT_EQ(2, enquirer::utils::display_width("\xFF\xC3"));                 // Invalid and truncated sequences
+}
+
+TEST(enquirer, inputWideCharacters) {
+    execWithCinRedirected([](stringstream &stream) {// The mark goes with its character
+        stream << "ae\u0301" << utils_char::arrow_left << utils_char::del << endl;
+        ASSERT_EQ("e\u0301", enquirer::input("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "日本語" << utils_char::arrow_left << utils_char::del << endl;
+        ASSERT_EQ("日語", enquirer::input("Type something"));
+    });
+
+    execWithCinRedirected([](stringstream &stream) {// Crossing a lone mark does not move the terminal cursor
+        stream << "\u0301" << utils_char::arrow_left << utils_char::arrow_right << endl;
+
+        stringstream output;
+        streambuf *old = cout.rdbuf(output.rdbuf());
+        enquirer::set_flush_policy(enquirer::flush_policy::stream);
+        string res = enquirer::input("Type something");
+        enquirer::set_flush_policy(enquirer::flush_policy::frame);
+        cout.rdbuf(old);
+
+        ASSERT_EQ("\u0301", res);
+        ASSERT_EQ(string::npos, output.str().find("\033[0D"));
+        ASSERT_EQ(string::npos, output.str().find("\033[0C"));
+    });
+}
+
+// Rows drawn by `output` on a terminal `width` columns wide, the characters which are not ASCII are drawn as '?'
+struct terminal_screen {
+    vector<string> rows;
+    size_t row     = 0;
+    size_t column  = 0;
+    bool wrapped   = false;// A character was written past the last column
+    bool clamped   = false;// The cursor was moved right past the last column
+
+    terminal_screen(const string &output, size_t width) : rows(1, string(width, ' ')) {
+        for (size_t i = 0; i < output.size(); i++) {
+            const auto c = (unsigned char) output[i];
+            if (c == '\r') {
+                column = 0;
+            } else if (c == '\n') {
+                move_to(row + 1, 0, width);
+            } else if (c == '\033' && i + 1 < output.size() && output[i + 1] == '[') {
+                size_t j = i + 2;
+                size_t n = 0;
+                while (j < output.size() && !(output[j] >= 0x40 && output[j] <= 0x7E)) {
+                    n = isdigit((unsigned char) output[j]) ? n * 10 + (output[j] - '0') : 0;
+                    j++;
+                }
+                const size_t count = max(n, (size_t) 1);
+                switch (output[j]) {
+                    case 'A': row -= min(row, count); break;
+                    case 'B': move_to(row + count, column, width); break;
+                    case 'C':
+                        clamped |= column + count > width - 1;
+                        column = min(column + count, width - 1);
+                        break;
+                    case 'D': column -= min(column, count); break;
+                    case 'K': rows[row].replace(n == 2 ? 0 : column, string::npos, width - (n == 2 ? 0 : column), ' '); break;
+                }
+                i = j;
+            } else if (c == '\033') {// ESC 7, ESC 8
+                i++;
+            } else if (c >= 0x20 && (c & 0xC0) != 0x80) {
+                if (column >= width) {
+                    wrapped = true;
+                    move_to(row + 1, 0, width);
+                }
+                rows[row][column++] = (c < 0x80) ? (char) c : '?';
+            }
+        }
+    }
+
+    auto move_to(size_t to_row, size_t to_column, size_t width) -> void {
+        row    = to_row;
+        column = to_column;
+        if (rows.size() <= row) rows.resize(row + 1, string(width, ' '));
+    }
+};
+
+TEST(enquirer, inputWiderThanTerminal) {
+    // A pseudo terminal of 20 columns as stdout, for its size
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    ASSERT_GE(master, 0);
+    ASSERT_EQ(0, grantpt(master));
+    ASSERT_EQ(0, unlockpt(master));
+    int terminal = open(ptsname(master), O_RDWR | O_NOCTTY);
+    ASSERT_GE(terminal, 0);
+    struct winsize size {};
+    size.ws_row = 5;
+    size.ws_col = 20;
+    ioctl(terminal, TIOCSWINSZ, &size);
+    int old_stdout = dup(STDOUT_FILENO);
+    dup2(terminal, STDOUT_FILENO);
+    raise(SIGWINCH);
+
+    string left;
+    for (int i = 0; i < 10; i++) {
+        left += utils_char::arrow_left;
+    }
+    stringstream output;
+    typing_buffer keys({"", "abcdefghijklmnopqrstuvwxyz0123456789" + left + "X", utils_char::ctrl_a + "Y", "\n"}, output);
+    streambuf *old_in  = cin.rdbuf(&keys);
+    streambuf *old_out = cout.rdbuf(output.rdbuf());
+    enquirer::set_flush_policy(enquirer::flush_policy::stream);
+    string res = enquirer::input("Q");
+    enquirer::set_flush_policy(enquirer::flush_policy::frame);
+    cout.rdbuf(old_out);
+    cin.rdbuf(old_in);
+
+    dup2(old_stdout, STDOUT_FILENO);
+    close(old_stdout);
+    close(terminal);
+    close(master);
+    raise(SIGWINCH);
+    drainKeys();// The resize back to the size of the real stdout
+
+    ASSERT_EQ("Yabcdefghijklmnopqrstuvwxyz" "X0123456789", res);
+    ASSERT_EQ(3U, keys.marks.size());
+
+    // Edited in the middle of the scrolled answer: the row does not wrap and the terminal cursor is after the X
+    terminal_screen middle(output.str().substr(0, keys.marks[1]), size.ws_col);
+    ASSERT_FALSE(middle.wrapped);
+    ASSERT_FALSE(middle.clamped);
+    ASSERT_EQ(0U, middle.row);
+    ASSERT_EQ('X', middle.rows[0][middle.column - 1]);
+    ASSERT_EQ('0', middle.rows[0][middle.column]);
+    ASSERT_EQ(' ', middle.rows[0][size.ws_col - 1]);
+
+    // Back at the beginning
+    terminal_screen beginning(output.str().substr(0, keys.marks[2]), size.ws_col);
+    ASSERT_FALSE(beginning.wrapped);
+    ASSERT_FALSE(beginning.clamped);
+    ASSERT_EQ("? Q ? Yabcdefghijkl ", beginning.rows[0]);
+    ASSERT_EQ(7U, beginning.column);
+}
+
+TEST(utils, to_number) {
+    int i;
+    ASSERT_TRUE(enquirer::utils::to_number("-2147483648", i));
+    ASSERT_EQ(-2147483648LL, i);
+    ASSERT_FALSE(enquirer::utils::to_number("2147483648", i));
+    ASSERT_TRUE(enquirer::utils::to_number("+0xff", i));
+    ASSERT_EQ(255, i);
+    ASSERT_FALSE(enquirer::utils::to_number("1.0", i));
+    ASSERT_FALSE(enquirer::utils::to_number("--1", i));
+
+    unsigned char u;
+    ASSERT_FALSE(enquirer::utils::to_number("-1", u));
+    ASSERT_FALSE(enquirer::utils::to_number("256", u));
+
+    double d;
+    ASSERT_TRUE(enquirer::utils::to_number("-.5e1", d));
+    ASSERT_EQ(-5.0, d);
+    ASSERT_FALSE(enquirer::utils::to_number("nan", d));
+    ASSERT_FALSE(enquirer::utils::to_number("1e", d));
+    ASSERT_TRUE(enquirer::utils::to_number("0x1.8p1", d));
+    ASSERT_EQ(3.0, d);
+    ASSERT_FALSE(enquirer::utils::to_number("1e400", d));
+
+    float f;
+    ASSERT_FALSE(enquirer::utils::to_number("1e39", f));
+    long double l;
+    ASSERT_TRUE(enquirer::utils::to_number("1e39", l));
+    ASSERT_FALSE(enquirer::utils::number_prefix<float>("1e39"));
+
+    ASSERT_TRUE(enquirer::utils::number_prefix<double>("-1.e-"));
+    ASSERT_TRUE(enquirer::utils::number_prefix<int>("-0x"));
+    ASSERT_FALSE(enquirer::utils::number_prefix<int>("0x1p"));
+    ASSERT_FALSE(enquirer::utils::number_prefix<double>("1.2."));
+}
+
+TEST(utils, tokenize) {
+    const enquirer::list_format format;
+    ASSERT_THAT(enquirer::utils::tokenize("", format), IsEmpty());
+    ASSERT_THAT(enquirer::utils::tokenize("a,", format), ElementsAre("a"));
+    ASSERT_THAT(enquirer::utils::tokenize(" a ,, b", format), ElementsAre("a", "", "b"));
+    ASSERT_THAT(enquirer::utils::tokenize("\" a, b \",c", format), ElementsAre(" a, b ", "c"));
+    ASSERT_THAT(enquirer::utils::tokenize("\"a,b", format), ElementsAre("a,b"));// Quote never closed
+    ASSERT_THAT(enquirer::utils::tokenize("\"a\",b", {",", 0}), ElementsAre("\"a\"", "b"));
+}
+
+TEST(utils, viewport) {
+    using enquirer::utils::key;
+
+    auto view = enquirer::utils::fit_viewport(100, 7);// Question and cursor lines left
+    ASSERT_EQ(0U, view.top);
+    ASSERT_EQ(5U, view.height);
+    ASSERT_EQ(3U, enquirer::utils::fit_viewport(3, 7).height);
+    ASSERT_EQ(4U, enquirer::utils::fit_viewport(100, 7, 1).height);
+    ASSERT_EQ(100U, enquirer::utils::fit_viewport(100, 0).height);// Unknown size
+
+    view.scroll_to(4);
+    ASSERT_EQ(0U, view.top);
+    view.scroll_to(5);
+    ASSERT_EQ(1U, view.top);
+    view.scroll_to(99);
+    ASSERT_EQ(95U, view.top);
+    view.scroll_to(97);
+    ASSERT_EQ(95U, view.top);
+    view.scroll_to(10);
+    ASSERT_EQ(10U, view.top);
+
+    enquirer::utils::refit(view, 100, 4);// Shrunk
+    ASSERT_EQ(2U, view.height);
+    ASSERT_EQ(10U, view.top);
+    view.scroll_to(99);
+    enquirer::utils::refit(view, 100, 12);// Grown at the end of the list
+    ASSERT_EQ(10U, view.height);
+    ASSERT_EQ(90U, view.top);
+    enquirer::utils::refit(view, 20, 12);// Fewer rows
+    ASSERT_EQ(10U, view.top);
+
+    ASSERT_EQ(0U, enquirer::utils::jump(key::home, 42, 100, 5));
+    ASSERT_EQ(99U, enquirer::utils::jump(key::end, 42, 100, 5));
+    ASSERT_EQ(37U, enquirer::utils::jump(key::page_up, 42, 100, 5));
+    ASSERT_EQ(0U, enquirer::utils::jump(key::page_up, 3, 100, 5));
+    ASSERT_EQ(47U, enquirer::utils::jump(key::page_down, 42, 100, 5));
+    ASSERT_EQ(99U, enquirer::utils::jump(key::page_down, 97, 100, 5));
+    ASSERT_EQ(43U, enquirer::utils::jump(key::page_down, 42, 100, 0));// At least one row
+    ASSERT_EQ(42U, enquirer::utils::jump(key::up, 42, 100, 5));
+}
+
+TEST(utils, slider_cell) {
+    ASSERT_EQ(0, enquirer::utils::slider_cell(0, 0, 1, 20));
+    ASSERT_EQ(19, enquirer::utils::slider_cell(19, 0, 1, 20));
+    ASSERT_EQ(4, enquirer::utils::slider_cell(45, 0, 10, 10));
+    ASSERT_EQ(3, enquirer::utils::slider_cell(0.35, 0.0, 0.1, 10));
+    ASSERT_EQ(-1, enquirer::utils::slider_cell(120, 0, 10, 10));
+}
+
+TEST(utils, terminal_resize) {
+    enquirer::utils::terminal_size();
+    raise(SIGWINCH);
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "a";
+        enquirer::utils::key_event event;
+        ASSERT_TRUE(enquirer::utils::read_key(event));
+        ASSERT_EQ(enquirer::utils::key::resize, event.code);
+        ASSERT_TRUE(enquirer::utils::read_key(event));
+        ASSERT_EQ('a', event.character);
+    });
+
+    raise(SIGWINCH);
+    execWithCinRedirected([](stringstream &stream) {
+        stream << utils_char::arrow_down << endl;
+        string res = enquirer::select("Choose", {"a", "b", "c"});
+        ASSERT_STREQ("b", res.c_str());
+    });
+}
+
+static volatile sig_atomic_t program_winch = 0;
+
+TEST(utils, terminal_resize_chained) {
+    // In a new process, so that the SIGWINCH action of the program is installed before the one of enquirer
+    GTEST_FLAG(death_test_style) = "threadsafe";
+    EXPECT_EXIT({
+        struct sigaction action {};
+        action.sa_sigaction = [](int signal, siginfo_t *info, void *context) {
+            program_winch = signal == SIGWINCH && info != nullptr && info->si_signo == SIGWINCH && context != nullptr;
+        };
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGWINCH, &action, nullptr);
+
+        enquirer::utils::terminal_size();
+        raise(SIGWINCH);
+        exit(program_winch ? 0 : 1);
+    }, ExitedWithCode(0), "");
+}
+
+TEST(utils, terminal_resize_paste) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    int old_stdin = dup(STDIN_FILENO);
+    dup2(fds[0], STDIN_FILENO);
+    enquirer::utils::terminal_size();
+
+    thread writer([&fds] {// Resized in the middle of a paste, the resize must not be polled until its end
+        const string first = utils_char::paste_begin + "abc";
+        const string last  = "def" + utils_char::paste_end + "x";
+        [[maybe_unused]] auto written = write(fds[1], first.data(), first.size());
+        this_thread::sleep_for(chrono::milliseconds(50));
+        raise(SIGWINCH);
+        this_thread::sleep_for(chrono::milliseconds(200));
+        written = write(fds[1], last.data(), last.size());
+    });
+
+    const clock_t start = clock();
+    enquirer::utils::key_event paste, resize, character;
+    const bool read = enquirer::utils::read_key(paste);
+    const clock_t elapsed = clock() - start;
+    writer.join();
+    enquirer::utils::read_key(resize);
+    enquirer::utils::read_key(character);
+
+    dup2(old_stdin, STDIN_FILENO);
+    close(old_stdin);
+    close(fds[0]);
+    close(fds[1]);
+
+    ASSERT_TRUE(read);
+    ASSERT_EQ(enquirer::utils::key::paste, paste.code);
+    ASSERT_EQ("abcdef", paste.text);
+    ASSERT_EQ(enquirer::utils::key::resize, resize.code);
+    ASSERT_EQ('x', character.character);
+    ASSERT_LT(elapsed, CLOCKS_PER_SEC / 10);
+}
+
+TEST(enquirer, headless) {
+    enquirer::set_prompt_mode(enquirer::prompt_mode::headless);
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "bob" << endl
+               << endl
+               << "Hobby=chess" << endl
+               << "python" << endl
+               << "b, c" << endl
+               << "yes" << endl
+               << "42" << endl
+               << "  " << endl
+               << "Name=alice" << endl
+               << "Age=27" << endl;
+        ASSERT_STREQ("bob", enquirer::input("Hobby").c_str());
+        ASSERT_STREQ("", enquirer::input("Name", "john").c_str());// As Enter without Tab
+        ASSERT_STREQ("chess", enquirer::input("Hobby").c_str());
+        ASSERT_STREQ("python", enquirer::select("Language", {"c++", "python"}).c_str());
+        ASSERT_THAT(enquirer::multi_select("Letters", {"a", "b", "c"}), ElementsAre("b", "c"));
+        ASSERT_TRUE(enquirer::confirm("Sure?"));
+        ASSERT_EQ(42, enquirer::number<int>("Number"));
+        ASSERT_EQ(0, enquirer::number<int>("Number"));// As Enter on an empty answer
+        auto answers = enquirer::form("Who", {"Name", "Age"});
+        ASSERT_STREQ("alice", answers["Name"].c_str());
+        ASSERT_STREQ("27", answers["Age"].c_str());
+    });
+
+    execWithCinRedirected([](stringstream &stream) {
+        stream << "rust" << endl
+               << "4x" << endl;
+        ASSERT_THROW(enquirer::select("Language", {"c++", "python"}), enquirer::answer_error);
+        ASSERT_THROW(enquirer::number<int>("Number"), enquirer::answer_error);
+        ASSERT_THROW(enquirer::input("Name"), enquirer::answer_error);// No more answers
+    });
+
+    enquirer::set_prompt_mode(enquirer::prompt_mode::interactive);
+
+    execWithCinRedirected([](stringstream &stream) {// The same empty answers in the prompts
+        stream << endl
+               << endl;
+        ASSERT_STREQ("", enquirer::input("Name", "john").c_str());
+        ASSERT_EQ(0, enquirer::number<int>("Number"));
+    });
+}